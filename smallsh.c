@@ -6,6 +6,8 @@
 /**
 * Includes
 */
+//needed for fstatat and other POSIX 2008 functions
+#define _GNU_SOURCE
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -29,6 +31,29 @@
 //for open
 #include <fcntl.h>
 #include <sys/stat.h>
+//for putting the terminal in raw mode for line editing
+#include <termios.h>
+//for getting terminal width
+#include <sys/ioctl.h>
+//for cloning files in 'cp' and 'cat'
+#include <linux/fs.h>
+#include <sys/sendfile.h>
+#include <limits.h>
+//for waiting on several file descriptors at once
+#include <poll.h>
+//for command deadlines
+#include <sys/timerfd.h>
+#include <time.h>
+#include <stdint.h>
+//for rejecting durations that aren't finite
+#include <math.h>
+//for resource usage of finished commands
+#include <sys/resource.h>
+//for capturing output of background jobs
+#include <sys/epoll.h>
+//for server mode
+#include <sys/socket.h>
+#include <sys/un.h>
 
 /**
 * Constants
@@ -47,6 +72,34 @@
 //used to represent uninitialized foreground pid
 #define NULL_FOREGROUND_PID -1
 
+//text written before reading each command
+#define PROMPT_STRING ": "
+
+//maximum number of completion candidates printed when tab completion
+//is ambiguous - any more are summarized with a count
+#define COMPLETION_DISPLAY_LIMIT 200
+
+//ascii control characters handled by the line editor
+#define CONTROL_KEY(key) ((key) & 0x1f)
+#define ESCAPE_KEY 27
+#define BACKSPACE_KEY 127
+
+//size of buffer used to read input
+#define INPUT_BUFFER_SIZE 4096
+
+//flags returned by waitForShellEvent()
+#define SHELL_EVENT_INPUT 1
+#define SHELL_EVENT_TIMER 2
+#define SHELL_EVENT_CHILD 4
+
+//captured output of background jobs ('joblog'):
+//size of the in-memory ring kept for each job, total memory all rings can use,
+//how many logs of finished jobs are kept, and how many pipes are read at once
+#define JOB_LOG_RING_SIZE (64 * 1024)
+#define JOB_LOG_MEMORY_LIMIT (16 * 1024 * 1024)
+#define JOB_LOG_HISTORY_LIMIT 1024
+#define JOB_LOG_EVENT_COUNT 64
+
 //create custom bool class, since c99 is required for stdbool.h
 typedef int BOOL;
 //members of BOOL type
@@ -69,6 +122,17 @@ pid_t foregroundPid;
 BOOL foregroundInterrupted;
 //global variable to store signal number if foreground command is interrupted
 int foregroundInterruptSignal;
+//global variable storing if the foreground process leads its own process group
+//(commands run with 'timeout' do), so the whole group should be interrupted
+BOOL foregroundIsProcessGroup;
+
+//pipe written to by signal handlers when a child process changes state or control-c is pressed,
+//so the shell can wait for children, input, timers and interrupts all at once with poll()
+//instead of blocking in waitpid()
+int signalEventPipe[2];
+//global variable set whenever control-c is pressed, so built in commands that wait
+//can tell they were interrupted
+volatile sig_atomic_t interruptReceived = 0;
 
 //handles action for when user presses control-c when foreground process is running-
 //it will kill that process and print a message saying so
@@ -76,6 +140,11 @@ int foregroundInterruptSignal;
 //not allowed to use any functions that are not reentrant, so can only use the functions described
 //here: http://pubs.opengroup.org/onlinepubs/009695399/functions/xsh_chap02_04.html#tag_02_04_04
 void interruptHandler(int signalNum){
+    //wake up anything waiting in waitForShellEvent()
+    int savedErrno = errno;
+    interruptReceived = 1;
+    write(signalEventPipe[1], "i", 1);
+    errno = savedErrno;
     //don't do anything if there is no foreground process running
     //check if foreground pid is even initialized or foreground has already been interrupted
     if(foregroundPid == NULL_FOREGROUND_PID || foregroundInterrupted == TRUE){
@@ -85,7 +154,12 @@ void interruptHandler(int signalNum){
     //must have foreground process, so send it the signal sent to the handler
     //based on: http://stackoverflow.com/questions/6501522/how-to-kill-a-child-process-by-the-parent-process
     //and http://www.csl.mtu.edu/cs4411.ck/www/NOTES/signal/kill.html
-    kill(foregroundPid, signalNum);
+    if(foregroundIsProcessGroup == TRUE){
+        kill(-foregroundPid, signalNum);
+    }
+    else{
+        kill(foregroundPid, signalNum);
+    }
     //set flags to show was interrupted
     foregroundInterrupted = TRUE;
     foregroundInterruptSignal = signalNum;
@@ -98,6 +172,7 @@ void initializeInterruptHandler(){
     foregroundPid = NULL_FOREGROUND_PID;
     //initialized foreground interrupted flag to false
     foregroundInterrupted = FALSE;
+    foregroundIsProcessGroup = FALSE;
 
     //struct to store signal action data
     struct sigaction act;
@@ -111,158 +186,504 @@ void initializeInterruptHandler(){
     sigaction(SIGINT, &act, NULL);
 }
 
+//handles SIGCHLD by writing to signalEventPipe, which wakes up waitForShellEvent()
+//write() is reentrant, so it is safe to use here
+void childSignalHandler(int signalNum){
+    //don't let write change errno for whatever code was interrupted
+    int savedErrno = errno;
+    write(signalEventPipe[1], "c", 1);
+    errno = savedErrno;
+}
+
+//called at the beginning of the program, it sets childSignalHandler() to be called
+//when a child process exits
+void initializeChildSignalHandler(){
+    //both ends are non-blocking, so a full pipe never blocks the handler
+    //and emptying the pipe never blocks the shell
+    //close on exec so commands don't inherit them
+    int pipeResult = pipe2(signalEventPipe, O_NONBLOCK | O_CLOEXEC);
+    assert(pipeResult == 0);
+
+    struct sigaction act;
+    act.sa_handler = childSignalHandler;
+    //restart interrupted system calls, so existing blocking calls aren't disturbed
+    act.sa_flags = SA_RESTART | SA_NOCLDSTOP;
+    sigfillset(&(act.sa_mask));
+    sigaction(SIGCHLD, &act, NULL);
+}
+
 
 
 /*************************************
-* Get user input functions
+* Deadline functions
 **************************************/
 
-//gets user input, stores in commandLineBuffer 
-//and chomps(deletes) trailing newline from pressing enter to input command
-void getUserInput(char commandLineBuffer[COMMAND_LINE_MAX_LENGTH]){
-    //clear the buffer
-    bzero(commandLineBuffer, COMMAND_LINE_MAX_LENGTH);
-    //string is less than max, since we need to put newline at the end and null char at end
-    fgets(commandLineBuffer, COMMAND_LINE_MAX_LENGTH - 1, stdin);
-    //check to see if command ends in newline-if so remove it
-    int length = strlen(commandLineBuffer);
-    //start at last character (last character is technically \0), but not counted by strlen
-    int indexOfLastChar = length - 1;
-    //check if last char is newline, and if so, replace with null char
-    if(commandLineBuffer[indexOfLastChar] == '\n'){
-        commandLineBuffer[indexOfLastChar] = '\0';
+//deadline for a command, set with the 'timeout' built in command
+struct CommandDeadline{
+    //how long the command is allowed to run
+    struct timespec duration;
+    //signal sent to the command's process group when duration is up
+    int signalNumber;
+    //if not zero, SIGKILL is sent this long after signalNumber
+    //if the command still hasn't exited
+    struct timespec killAfter;
+};
+
+//signal names accepted by 'timeout --signal', with or without the SIG prefix
+struct SignalName{
+    const char *name;
+    int signalNumber;
+};
+const struct SignalName signalNames[] = {
+    {"HUP", SIGHUP}, {"INT", SIGINT}, {"QUIT", SIGQUIT}, {"KILL", SIGKILL},
+    {"USR1", SIGUSR1}, {"USR2", SIGUSR2}, {"ALRM", SIGALRM}, {"TERM", SIGTERM},
+    {NULL, 0}
+};
+
+//global default deadline given to background commands started without 'timeout'
+//set with 'timeout --background'
+BOOL hasBackgroundDefaultDeadline = FALSE;
+struct CommandDeadline backgroundDefaultDeadline;
+
+//timer used to wake the shell when the earliest background deadline expires
+//global, so it can be polled from anywhere the shell waits
+int backgroundDeadlineTimer = -1;
+
+//creates the timer for background deadlines
+//called at the beginning of the program
+void initializeBackgroundDeadlineTimer(){
+    backgroundDeadlineTimer = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    assert(backgroundDeadlineTimer != -1);
+}
+
+//stores current time from monotonic clock in time
+void getMonotonicTime(struct timespec *time){
+    clock_gettime(CLOCK_MONOTONIC, time);
+}
+
+//returns microseconds since start
+uint64_t getElapsedMicroseconds(const struct timespec *start){
+    struct timespec now;
+    getMonotonicTime(&now);
+    return (uint64_t) (now.tv_sec - start->tv_sec) * 1000000 + (now.tv_nsec - start->tv_nsec) / 1000;
+}
+
+//stores a + b in result
+void addTimespec(const struct timespec *a, const struct timespec *b, struct timespec *result){
+    result->tv_sec = a->tv_sec + b->tv_sec;
+    result->tv_nsec = a->tv_nsec + b->tv_nsec;
+    if(result->tv_nsec >= 1000000000L){
+        result->tv_sec++;
+        result->tv_nsec -= 1000000000L;
     }
 }
 
-void writePrompt(){
-	printf(": ");
+//returns negative if a is before b, 0 if they are equal, and positive if a is after b
+int compareTimespec(const struct timespec *a, const struct timespec *b){
+    if(a->tv_sec != b->tv_sec){
+        return a->tv_sec < b->tv_sec ? -1 : 1;
+    }
+    if(a->tv_nsec != b->tv_nsec){
+        return a->tv_nsec < b->tv_nsec ? -1 : 1;
+    }
+    return 0;
 }
 
-/*************************************
-* Parse user input functions
-**************************************/
-//returns 1 'true' if command matches 'cd' or 'cd <directory_name>', 
-//0 'false' otherwise
-int isCommandCD(char commandLineBuffer[COMMAND_LINE_MAX_LENGTH], int bufferLength){
-    //sanity check - command must be at least length 2
-    //to contain 'cd'
-    if(bufferLength < 2){
-        return 0;
+BOOL isTimespecZero(const struct timespec *time){
+    return time->tv_sec == 0 && time->tv_nsec == 0;
+}
+
+//parses duration such as '10', '1.5s', '250ms', '2m', '1h' or '1d' into duration
+//returns FALSE if durationString is not a valid duration
+BOOL parseDuration(const char *durationString, struct timespec *duration){
+    char *end;
+    errno = 0;
+    double seconds = strtod(durationString, &end);
+    if(end == durationString || errno != 0 || seconds < 0){
+        return FALSE;
     }
-    //check for just plain 'cd'
-    if(strcmp(commandLineBuffer, "cd") == 0){
-        return 1;
+    if(strcmp(end, "ms") == 0){
+        seconds /= 1000;
     }
-    //if length is less than 3 can't be 'cd <directory_name>'
-    if(bufferLength < 3){
-        return 0;
+    else if(strcmp(end, "m") == 0){
+        seconds *= 60;
     }
-    //check for 'cd <directory_name>' - must start with 'cd<space_character>'
-    if(commandLineBuffer[0] == 'c' && commandLineBuffer[1] == 'd' && isspace(commandLineBuffer[2])){
-        return 1;
+    else if(strcmp(end, "h") == 0){
+        seconds *= 60 * 60;
     }
-    //must be false if we get here
-    return 0;
+    else if(strcmp(end, "d") == 0){
+        seconds *= 60 * 60 * 24;
+    }
+    else if(strcmp(end, "s") != 0 && *end != '\0'){
+        return FALSE;
+    }
+    //strtod() accepts "inf", "nan" and huge numbers, which don't fit in a time_t
+    if(!isfinite(seconds) || seconds > (double) INT_MAX){
+        return FALSE;
+    }
+    duration->tv_sec = (time_t) seconds;
+    duration->tv_nsec = (long) ((seconds - duration->tv_sec) * 1000000000L);
+    return TRUE;
+}
 
+//parses signal given as a number or name such as 'TERM' or 'SIGTERM'
+//returns signal number, or -1 if signalString is not a known signal
+int parseSignal(const char *signalString){
+    if(isdigit((unsigned char) signalString[0])){
+        int signalNumber = atoi(signalString);
+        return signalNumber > 0 && signalNumber < NSIG ? signalNumber : -1;
+    }
+    if(strncmp(signalString, "SIG", 3) == 0){
+        signalString += 3;
+    }
+    int i;
+    for(i = 0; signalNames[i].name != NULL; ++i){
+        if(strcmp(signalNames[i].name, signalString) == 0){
+            return signalNames[i].signalNumber;
+        }
+    }
+    return -1;
 }
 
-/*************************************
-* Status functions
-**************************************/
-//prints the status code
-//returns new status code which should always be 0
-//since status command should never fail
-int printStatus(int returnStatusCode){
-    //check if last process was stopped by signal
-    if(foregroundInterrupted == TRUE){
-        printf("terminated by signal %d\n", foregroundInterruptSignal);
+//arms timerFileDescriptor to expire at the absolute monotonic time expiresAt
+//or disarms it if expiresAt is NULL
+void armTimer(int timerFileDescriptor, const struct timespec *expiresAt){
+    struct itimerspec timerSettings;
+    bzero(&timerSettings, sizeof(timerSettings));
+    if(expiresAt != NULL){
+        timerSettings.it_value = *expiresAt;
+        //a zero time would disarm the timer instead of expiring it immediately
+        if(isTimespecZero(&timerSettings.it_value)){
+            timerSettings.it_value.tv_nsec = 1;
+        }
     }
-    else{
-        printf("exit value %d\n", returnStatusCode);
+    timerfd_settime(timerFileDescriptor, TFD_TIMER_ABSTIME, &timerSettings, NULL);
+}
+
+//sends signal to a command, or the whole process group it leads
+void signalJob(pid_t pid, BOOL isProcessGroup, int signalNumber){
+    if(isProcessGroup == TRUE){
+        //fall back to just the process if it hasn't made its process group yet
+        if(kill(-pid, signalNumber) == 0){
+            return;
+        }
     }
-    return 0;
+    kill(pid, signalNumber);
 }
 
 /*************************************
-* 'CD' functions
+* Journal functions
 **************************************/
-//executes 'cd' command in commandLineBuffer by
-//changing current working directory to that given in the command, or the home directory
-//if none given
-//if there is an error - such as directory not readable, not existing, or a file and not a directory
-//will print error message and not change working directory
-//returns status code - 0 means success, 1 means there was an error
-int executeCD(char commandLineBuffer[COMMAND_LINE_MAX_LENGTH], int bufferLength){
-    //extract directory from command
-    //initialize variable to hold directory
-    char *directoryName;
-    //need to know if we need to free directoryName, since
-    //getting environment variable doesn't allocate space
-    int didAllocateDirectoryName = 0;
-    //if just 'cd', directoryName should be home directory
-    if(strcmp(commandLineBuffer, "cd") == 0){
-        //don't allocate memory for directoryName, since getenv returns
-        //pointer to already existing string
-        directoryName = getenv("HOME");
-        //in the case that environment variable can't be found,
-        //null is returned, so check for that, as that is an error
-        if(directoryName == NULL){
-            return 1;
+
+//types of journal record
+//a line is recorded as killed when the shell exits with background commands from it still running or queued
+#define JOURNAL_STARTED 1
+#define JOURNAL_COMPLETED 2
+#define JOURNAL_KILLED 3
+//times a line killed by exiting is run again when resuming - after that it is skipped like a completed line,
+//so a script that exits with background commands running settles instead of restarting them on every resume
+#define JOURNAL_MAX_KILLED_RERUNS 1
+//records are written and synced to disk in batches - when this many are waiting,
+//or once the oldest waiting record is this old, so a crash loses at most a second of completions
+#define JOURNAL_BATCH_SIZE 64
+#define JOURNAL_SYNC_INTERVAL_MILLISECONDS 1000
+//number of buckets in table of lines read from the journal being resumed
+#define JOURNAL_TABLE_SIZE 4096
+
+//record in journal file, written when a line of input starts and when it completes
+//lines are identified by line number and the hash of their text, so a line that has been edited since is run again
+struct JournalRecord{
+    uint32_t lineNumber;
+    uint32_t type;
+    uint64_t lineHash;
+};
+
+//line of input that has started, but not completed
+//it completes once its foreground commands have finished and every background command it started has been reaped
+struct JournalLine{
+    uint32_t lineNumber;
+    uint64_t lineHash;
+    //TRUE once the commands in the line have been run
+    BOOL isForegroundDone;
+    //background commands from the line that are queued or running
+    int pendingCount;
+    struct JournalLine *previous;
+    struct JournalLine *next;
+};
+
+//line found in the journal being resumed
+struct JournalEntry{
+    uint32_t lineNumber;
+    uint64_t lineHash;
+    BOOL isCompleted;
+    //number of runs that exited with the line's background commands unfinished
+    int killedCount;
+    struct JournalEntry *next;
+};
+
+//journal written with --journal
+struct Journal{
+    //journal file, -1 when not journaling
+    int fileDescriptor;
+    //records waiting to be written, and when the oldest of them was added
+    struct JournalRecord batch[JOURNAL_BATCH_SIZE];
+    int batchCount;
+    struct timespec batchStartTime;
+    //lines that have started but not completed
+    struct JournalLine *openLines;
+    //line that commands being started belong to, NULL if they don't belong to one
+    struct JournalLine *currentLine;
+    //lines from the journal being resumed, hashed by line number
+    struct JournalEntry *entries[JOURNAL_TABLE_SIZE];
+    //cost of journaling, shown by 'stats'
+    unsigned long recordCount;
+    unsigned long syncCount;
+    uint64_t syncMicroseconds;
+    unsigned long skippedLineCount;
+};
+
+struct Journal journal = {.fileDescriptor = -1};
+
+//writes waiting records to the journal file and syncs it to disk
+//if they can't be written or synced, journaling stops, since resuming can't rely on a journal with records missing
+void syncJournal(){
+    if(journal.batchCount == 0){
+        return;
+    }
+    struct timespec startTime;
+    getMonotonicTime(&startTime);
+    const char *data = (const char *) journal.batch;
+    size_t length = sizeof(struct JournalRecord) * journal.batchCount;
+    while(length > 0){
+        ssize_t bytesWritten = write(journal.fileDescriptor, data, length);
+        if(bytesWritten == -1 && errno == EINTR){
+            continue;
         }
+        if(bytesWritten <= 0){
+            break;
+        }
+        data += bytesWritten;
+        length -= bytesWritten;
+    }
+    if(length > 0 || fdatasync(journal.fileDescriptor) == -1){
+        printf("journal: error writing records: %s, journaling stopped\n", strerror(errno));
+        close(journal.fileDescriptor);
+        journal.fileDescriptor = -1;
+        journal.batchCount = 0;
+        return;
+    }
+    journal.batchCount = 0;
+    journal.syncCount++;
+    journal.syncMicroseconds += getElapsedMicroseconds(&startTime);
+}
+
+//syncs waiting records if the oldest of them has waited long enough
+//returns how many milliseconds until records should be synced, or -1 if none are waiting,
+//for use as a poll() timeout
+int syncJournalIfDue(){
+    if(journal.batchCount == 0){
+        return -1;
+    }
+    uint64_t waitedMilliseconds = getElapsedMicroseconds(&journal.batchStartTime) / 1000;
+    if(waitedMilliseconds >= JOURNAL_SYNC_INTERVAL_MILLISECONDS){
+        syncJournal();
+        return -1;
+    }
+    return JOURNAL_SYNC_INTERVAL_MILLISECONDS - waitedMilliseconds;
+}
+
+//adds record of type for line to the batch of records waiting to be written
+//lines still open when journaling stopped don't add any
+void addJournalRecord(const struct JournalLine *line, uint32_t type){
+    if(journal.fileDescriptor == -1){
+        return;
+    }
+    if(journal.batchCount == 0){
+        getMonotonicTime(&journal.batchStartTime);
+    }
+    struct JournalRecord *record = &journal.batch[journal.batchCount++];
+    record->lineNumber = line->lineNumber;
+    record->type = type;
+    record->lineHash = line->lineHash;
+    journal.recordCount++;
+    if(journal.batchCount == JOURNAL_BATCH_SIZE){
+        syncJournal();
+    }
+}
+
+//records that line lineNumber with hash lineHash has started
+//it becomes the current line, so background commands started from now on hold it open
+struct JournalLine * startJournalLine(uint32_t lineNumber, uint64_t lineHash){
+    struct JournalLine *line = calloc(1, sizeof(struct JournalLine));
+    assert(line != NULL);
+    line->lineNumber = lineNumber;
+    line->lineHash = lineHash;
+    line->next = journal.openLines;
+    if(journal.openLines != NULL){
+        journal.openLines->previous = line;
+    }
+    journal.openLines = line;
+    journal.currentLine = line;
+    addJournalRecord(line, JOURNAL_STARTED);
+    return line;
+}
+
+//records that line has completed once nothing is left running from it, and frees it
+void completeJournalLineIfDone(struct JournalLine *line){
+    if(line->isForegroundDone == FALSE || line->pendingCount > 0){
+        return;
+    }
+    addJournalRecord(line, JOURNAL_COMPLETED);
+    if(line->previous != NULL){
+        line->previous->next = line->next;
     }
-    //else all data after 'cd ' is directory name
     else{
-        //allocate memory for directoryName
-        directoryName = malloc(sizeof(char) * COMMAND_LINE_MAX_LENGTH);
-        //check malloc succeeded
-        assert(directoryName != NULL);
-        //save that we allocated memory
-        didAllocateDirectoryName = 1;
-        //fill with null bytes
-        bzero(directoryName, COMMAND_LINE_MAX_LENGTH);
-        //based on: http://stackoverflow.com/questions/6205195/how-can-i-copy-part-of-another-string-in-c-given-a-starting-and-ending-index
-        //int startIndex = &commandLineBuffer + 2;
-        strncpy(directoryName, (char *) &commandLineBuffer[3], bufferLength - 3);
+        journal.openLines = line->next;
     }
-    //change working directory - if return value is -1 there were errors, 0 means it succeeded
-    //based on: https://www.gnu.org/software/libc/manual/html_node/Working-Directory.html
-    //and http://stackoverflow.com/questions/12510874/how-can-i-check-if-a-directory-exists
-    //and http://pubs.opengroup.org/onlinepubs/009695399/functions/opendir.html
-    int changeWorkingDirectoryReturnValue = chdir(directoryName);
-    if(changeWorkingDirectoryReturnValue == 0){
-        //directory exists, and is readable and user has permissions
-        //free memory if we allocated it
-        if(didAllocateDirectoryName){
-            free(directoryName);
+    if(line->next != NULL){
+        line->next->previous = line->previous;
+    }
+    free(line);
+}
+
+//called after the commands in line have been run
+void finishJournalLine(struct JournalLine *line){
+    journal.currentLine = NULL;
+    line->isForegroundDone = TRUE;
+    completeJournalLineIfDone(line);
+}
+
+//called when a background command is queued or started, so the current line stays open until it is done
+//returns the current line, or NULL if there isn't one
+struct JournalLine * holdJournalLine(){
+    if(journal.currentLine != NULL){
+        journal.currentLine->pendingCount++;
+    }
+    return journal.currentLine;
+}
+
+//called when a background command held line open is done with it (line can be NULL)
+void releaseJournalLine(struct JournalLine *line){
+    if(line == NULL){
+        return;
+    }
+    line->pendingCount--;
+    completeJournalLineIfDone(line);
+}
+
+//returns the entry for line lineNumber with hash lineHash from the journal being resumed, or NULL if there isn't one
+struct JournalEntry * findJournalEntry(uint32_t lineNumber, uint64_t lineHash){
+    struct JournalEntry *entry;
+    for(entry = journal.entries[lineNumber % JOURNAL_TABLE_SIZE]; entry != NULL; entry = entry->next){
+        if(entry->lineNumber == lineNumber && entry->lineHash == lineHash){
+            return entry;
         }
-        return 0;
     }
-    //there was an error, so figure out what it was 
-    //and print out relevant error message
-    switch(errno){
-        //directoryName is a file, not a directory
-        case ENOTDIR:
-            printf("%s is not a directory\n", directoryName);
-            break;
-        //no permission
-        case EACCES:
-            printf("You do not have permission to view %s\n", directoryName);
-            break;
-        //directory name empty or directory doesn't exist
-        case ENOENT:
-            printf("%s does not exist\n", directoryName);
-            break;
-        //generic error message
-        default:
-            printf("Could not open %s\n", directoryName);
+    return NULL;
+}
+
+//returns TRUE if line lineNumber with hash lineHash completed in the journal being resumed,
+//or was killed by exiting too many times to run again
+BOOL isJournalLineCompleted(uint32_t lineNumber, uint64_t lineHash){
+    struct JournalEntry *entry = findJournalEntry(lineNumber, lineHash);
+    return entry != NULL && (entry->isCompleted == TRUE || entry->killedCount > JOURNAL_MAX_KILLED_RERUNS);
+}
+
+//reads records from journal file at fileDescriptor, so completed lines can be skipped
+//a record cut short by a crash is ignored, and cut off so new records line up after the last whole one
+void loadJournal(int fileDescriptor){
+    struct JournalRecord records[JOURNAL_BATCH_SIZE];
+    off_t wholeLength = 0;
+    ssize_t bytesRead;
+    while((bytesRead = read(fileDescriptor, records, sizeof(records))) > 0){
+        int recordCount = bytesRead / sizeof(struct JournalRecord);
+        int i;
+        for(i = 0; i < recordCount; ++i){
+            struct JournalEntry *entry = findJournalEntry(records[i].lineNumber, records[i].lineHash);
+            if(entry == NULL){
+                entry = calloc(1, sizeof(struct JournalEntry));
+                assert(entry != NULL);
+                entry->lineNumber = records[i].lineNumber;
+                entry->lineHash = records[i].lineHash;
+                struct JournalEntry **bucket = &journal.entries[entry->lineNumber % JOURNAL_TABLE_SIZE];
+                entry->next = *bucket;
+                *bucket = entry;
+            }
+            if(records[i].type == JOURNAL_COMPLETED){
+                entry->isCompleted = TRUE;
+            }
+            else if(records[i].type == JOURNAL_KILLED){
+                entry->killedCount++;
+            }
+        }
+        wholeLength += recordCount * sizeof(struct JournalRecord);
+        //partial record can only be at the end of the file
+        if(bytesRead % sizeof(struct JournalRecord) != 0){
             break;
+        }
     }
-    //free memory if we allocated it
-    if(didAllocateDirectoryName){
-        free(directoryName);
+    ftruncate(fileDescriptor, wholeLength);
+}
+
+//opens journal at path, used with --journal
+//with isResuming, lines already completed in it are skipped and new records are added to the end,
+//otherwise it is started over
+//returns FALSE if it couldn't be opened
+BOOL openJournal(const char *path, BOOL isResuming){
+    journal.fileDescriptor = open(path, O_RDWR | O_CREAT | O_APPEND | O_CLOEXEC | (isResuming == TRUE ? 0 : O_TRUNC), 0644);
+    if(journal.fileDescriptor == -1){
+        printf("cannot open journal %s: %s\n", path, strerror(errno));
+        return FALSE;
+    }
+    if(isResuming == FALSE){
+        return TRUE;
+    }
+    loadJournal(journal.fileDescriptor);
+    //lines that started but never completed were still running when the shell stopped, and are run again
+    int completedCount = 0;
+    int inFlightCount = 0;
+    int abandonedCount = 0;
+    int i;
+    struct JournalEntry *entry;
+    for(i = 0; i < JOURNAL_TABLE_SIZE; ++i){
+        for(entry = journal.entries[i]; entry != NULL; entry = entry->next){
+            if(entry->isCompleted == TRUE){
+                completedCount++;
+            }
+            else if(isJournalLineCompleted(entry->lineNumber, entry->lineHash) == TRUE){
+                abandonedCount++;
+            }
+            else{
+                inFlightCount++;
+            }
+        }
+    }
+    printf("resuming from %s: %d lines completed, %d to run again", path, completedCount, inFlightCount);
+    if(abandonedCount > 0){
+        printf(", %d killed by exiting again and skipped", abandonedCount);
+    }
+    printf("\n");
+    return TRUE;
+}
+
+//records lines whose background commands were killed or never started by exiting, writes any waiting records, and stops journaling
+//called before program exits, after background commands have been stopped
+//the line with 'exit' itself is left incomplete, so resuming exits at the same place
+void closeJournal(){
+    if(journal.fileDescriptor == -1){
+        return;
+    }
+    struct JournalLine *line;
+    for(line = journal.openLines; line != NULL; line = line->next){
+        if(line->isForegroundDone == TRUE && line->pendingCount > 0){
+            addJournalRecord(line, JOURNAL_KILLED);
+        }
+    }
+    syncJournal();
+    if(journal.fileDescriptor != -1){
+        close(journal.fileDescriptor);
+        journal.fileDescriptor = -1;
     }
-    //return 1 since there was an error
-    return 1;
 }
 
 /**************************************************
@@ -274,6 +695,29 @@ int executeCD(char commandLineBuffer[COMMAND_LINE_MAX_LENGTH], int bufferLength)
 //can be easily removed
 struct BackgroundProcessNode{
     pid_t processId;
+    //TRUE if process leads its own process group, so signals go to the whole group
+    BOOL isProcessGroup;
+    //TRUE if process has a deadline that hasn't been fully enforced yet
+    BOOL hasDeadline;
+    struct CommandDeadline deadline;
+    //when the next deadline signal should be sent
+    struct timespec expiresAt;
+    //TRUE once deadline.signalNumber has been sent, so only SIGKILL is left to send
+    BOOL isDeadlineSignalSent;
+    //statistics to add to when process is reaped, and when it was started
+    struct CommandStats *commandStats;
+    struct timespec startTime;
+    //TRUE if process was started from the admission queue, and its pid hasn't been printed yet
+    BOOL isAnnouncePending;
+    //how long it waited in the admission queue
+    uint64_t queuedMicroseconds;
+    //journaled line the process was started from, which stays open until it is reaped
+    struct JournalLine *journalLine;
+    //TRUE once the process has been reaped, which happens as soon as the shell notices it has finished,
+    //even if it is reported later - its status, and how many processes finished before it, are kept until then
+    BOOL hasFinished;
+    int finishedStatus;
+    unsigned long finishOrder;
     struct BackgroundProcessNode *previous;
     struct BackgroundProcessNode *next;
 };
@@ -282,22 +726,33 @@ struct BackgroundProcessNode{
 //works like a stack, with new background pids added to the front
 struct BackgroundProcessList{
   struct BackgroundProcessNode *head;
+  //number of processes reaped so far, used to number them in the order they finished
+  unsigned long finishCount;
 };
 
 //initialize linked list with null for first item
 //since it is empty
 void initializeBackgroundProcessList(struct BackgroundProcessList *backgroundProcessList){
     backgroundProcessList->head = NULL;
+    backgroundProcessList->finishCount = 0;
 }
 
 //adds pid to front of list
-void addToBackgroundProcessList(pid_t pid, struct BackgroundProcessList *backgroundProcessList){
+//returns the new node
+struct BackgroundProcessNode * addToBackgroundProcessList(pid_t pid, struct BackgroundProcessList *backgroundProcessList){
     //allocate memory
     struct BackgroundProcessNode *node = malloc(sizeof(struct BackgroundProcessNode));
     //check it succeeded
     assert(node != NULL);
     //save pid
     node->processId = pid;
+    //no deadline until one is set
+    node->isProcessGroup = FALSE;
+    node->hasDeadline = FALSE;
+    node->isDeadlineSignalSent = FALSE;
+    node->commandStats = NULL;
+    node->journalLine = NULL;
+    node->hasFinished = FALSE;
     //will be first item, so previous is null
     node->previous = NULL;
     //set next to null, will be changed if there should be something next
@@ -312,6 +767,7 @@ void addToBackgroundProcessList(pid_t pid, struct BackgroundProcessList *backgro
     }
     //set new head of the list
     backgroundProcessList->head = node;
+    return node;
 }
 
 //remove node from the list
@@ -336,530 +792,5778 @@ void removeFromBackgroundProcessList(struct BackgroundProcessNode *node, struct
 }
 
 
+//sets background deadline timer to go off at the earliest deadline
+//of any background process, or disarms it if there are none
+void rearmBackgroundDeadlineTimer(struct BackgroundProcessList *backgroundProcessList){
+    struct timespec *earliest = NULL;
+    struct BackgroundProcessNode *node;
+    for(node = backgroundProcessList->head; node != NULL; node = node->next){
+        if(node->hasDeadline == TRUE && (earliest == NULL || compareTimespec(&node->expiresAt, earliest) < 0)){
+            earliest = &node->expiresAt;
+        }
+    }
+    armTimer(backgroundDeadlineTimer, earliest);
+}
+
+//gives background process a deadline starting now
+void setBackgroundProcessDeadline(struct BackgroundProcessNode *node, const struct CommandDeadline *deadline, struct BackgroundProcessList *backgroundProcessList){
+    struct timespec now;
+    getMonotonicTime(&now);
+    node->hasDeadline = TRUE;
+    node->deadline = *deadline;
+    addTimespec(&now, &deadline->duration, &node->expiresAt);
+    rearmBackgroundDeadlineTimer(backgroundProcessList);
+}
+
+//signals background processes whose deadline has passed
+//processes are reaped as usual by printBackgroundProcessStatus()
+void expireBackgroundDeadlines(struct BackgroundProcessList *backgroundProcessList){
+    struct timespec now;
+    getMonotonicTime(&now);
+    struct BackgroundProcessNode *node;
+    for(node = backgroundProcessList->head; node != NULL; node = node->next){
+        if(node->hasDeadline == FALSE || compareTimespec(&node->expiresAt, &now) > 0){
+            continue;
+        }
+        //deadline signal already sent and kill-after time is up
+        if(node->isDeadlineSignalSent == TRUE){
+            signalJob(node->processId, node->isProcessGroup, SIGKILL);
+            node->hasDeadline = FALSE;
+            continue;
+        }
+        signalJob(node->processId, node->isProcessGroup, node->deadline.signalNumber);
+        node->isDeadlineSignalSent = TRUE;
+        if(isTimespecZero(&node->deadline.killAfter)){
+            node->hasDeadline = FALSE;
+        }
+        else{
+            addTimespec(&now, &node->deadline.killAfter, &node->expiresAt);
+        }
+    }
+    rearmBackgroundDeadlineTimer(backgroundProcessList);
+}
+
+
 /*************************************
-* Execute arbitrary command functions
+* Captured output of background jobs
 **************************************/
 
+//output of a background job, captured through a pipe while 'joblog on' is in effect
+//the newest output is kept in a ring buffer in memory, and older output is moved to a spill file on disk,
+//so all of it can be read back while memory use stays bounded
+struct JobLog{
+    pid_t processId;
+    //unique for every log, since pids are reused while old logs are still kept
+    unsigned long sequenceNumber;
+    //command line the job was started with
+    char *commandLine;
+    //read end of the pipe the job writes to, -1 once the job (and everything it started) has closed it
+    int pipeFileDescriptor;
+    //ring buffer with the newest output - ringCapacity is 0 while there is no memory for one
+    char *ring;
+    int ringCapacity;
+    //index in ring of the oldest byte, and number of bytes in ring
+    int ringStart;
+    int ringLength;
+    //bytes the job has written, and how many of them (the oldest ones) are in the spill file instead of ring
+    uint64_t totalBytes;
+    uint64_t spilledBytes;
+    //TRUE if writing to the spill file failed, so some output is missing
+    BOOL hasSpillError;
+    struct JobLog *next;
+};
+
+//captured output of background jobs, oldest job first
+struct JobLogList{
+    struct JobLog *head;
+    struct JobLog *tail;
+    //number of logs whose pipe has been closed
+    int finishedCount;
+    //bytes allocated for ring buffers, kept under JOB_LOG_MEMORY_LIMIT
+    size_t ringMemory;
+    //TRUE while output of new background jobs should be captured
+    BOOL isCapturing;
+    //epoll instance watching the pipes of running jobs, -1 until capture is first turned on
+    int epollFileDescriptor;
+    //directory spill files are written to, empty until first needed
+    char spillDirectory[256];
+    //sequence number given to the next log created
+    unsigned long nextSequenceNumber;
+};
+struct JobLogList jobLogs = {.epollFileDescriptor = -1};
+
+//stores path of the spill file for log in path
+//returns FALSE if the directory for spill files couldn't be created
+BOOL getJobLogSpillPath(struct JobLog *log, char path[512]){
+    if(jobLogs.spillDirectory[0] == '\0'){
+        const char *temporaryDirectory = getenv("TMPDIR");
+        if(temporaryDirectory == NULL || temporaryDirectory[0] == '\0'){
+            temporaryDirectory = "/tmp";
+        }
+        snprintf(jobLogs.spillDirectory, sizeof(jobLogs.spillDirectory), "%s/smallsh-joblog-XXXXXX", temporaryDirectory);
+        if(mkdtemp(jobLogs.spillDirectory) == NULL){
+            jobLogs.spillDirectory[0] = '\0';
+            return FALSE;
+        }
+    }
+    snprintf(path, 512, "%s/%lu", jobLogs.spillDirectory, log->sequenceNumber);
+    return TRUE;
+}
+
+//appends the length bytes in data to the spill file of log
+//the spill file is only open while writing, so thousands of logs don't use up file descriptors
+void writeToJobLogSpill(struct JobLog *log, const char *data, size_t length){
+    log->spilledBytes += length;
+    char path[512];
+    int fileDescriptor = -1;
+    if(getJobLogSpillPath(log, path) == TRUE){
+        fileDescriptor = open(path, O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0600);
+    }
+    while(fileDescriptor != -1 && length > 0){
+        ssize_t written = write(fileDescriptor, data, length);
+        if(written <= 0){
+            break;
+        }
+        data += written;
+        length -= written;
+    }
+    if(length > 0){
+        log->hasSpillError = TRUE;
+    }
+    if(fileDescriptor != -1){
+        close(fileDescriptor);
+    }
+}
+
+//moves the count oldest bytes in the ring of log to its spill file
+void spillJobLogRing(struct JobLog *log, int count){
+    if(count == 0){
+        return;
+    }
+    //ring may wrap around, in which case the bytes are in two pieces
+    int firstLength = log->ringCapacity - log->ringStart;
+    if(firstLength > count){
+        firstLength = count;
+    }
+    writeToJobLogSpill(log, &log->ring[log->ringStart], firstLength);
+    if(count > firstLength){
+        writeToJobLogSpill(log, log->ring, count - firstLength);
+    }
+    log->ringStart = (log->ringStart + count) % log->ringCapacity;
+    log->ringLength -= count;
+}
+
+//moves everything in the ring of log to its spill file and frees the ring
+void releaseJobLogRing(struct JobLog *log){
+    if(log->ringCapacity == 0){
+        return;
+    }
+    spillJobLogRing(log, log->ringLength);
+    free(log->ring);
+    log->ring = NULL;
+    jobLogs.ringMemory -= log->ringCapacity;
+    log->ringCapacity = 0;
+    log->ringStart = 0;
+}
+
+//gives log a ring buffer, if that fits under JOB_LOG_MEMORY_LIMIT
+//rings of finished jobs are moved to disk, oldest first, to make room
+//returns FALSE if there is still no room, in which case output goes straight to the spill file
+BOOL allocateJobLogRing(struct JobLog *log){
+    struct JobLog *oldest = jobLogs.head;
+    while(jobLogs.ringMemory + JOB_LOG_RING_SIZE > JOB_LOG_MEMORY_LIMIT && oldest != NULL){
+        if(oldest->pipeFileDescriptor == -1){
+            releaseJobLogRing(oldest);
+        }
+        oldest = oldest->next;
+    }
+    if(jobLogs.ringMemory + JOB_LOG_RING_SIZE > JOB_LOG_MEMORY_LIMIT){
+        return FALSE;
+    }
+    log->ring = malloc(JOB_LOG_RING_SIZE);
+    assert(log->ring != NULL);
+    log->ringCapacity = JOB_LOG_RING_SIZE;
+    log->ringStart = 0;
+    log->ringLength = 0;
+    jobLogs.ringMemory += JOB_LOG_RING_SIZE;
+    return TRUE;
+}
+
+//adds length bytes of output in data to log
+//never blocks the job - when the ring is full, its oldest bytes are moved to the spill file
+void appendToJobLog(struct JobLog *log, const char *data, size_t length){
+    log->totalBytes += length;
+    if(log->ringCapacity == 0 && allocateJobLogRing(log) == FALSE){
+        writeToJobLogSpill(log, data, length);
+        return;
+    }
+    //output bigger than the ring only keeps its end in the ring
+    if(length >= (size_t) log->ringCapacity){
+        spillJobLogRing(log, log->ringLength);
+        writeToJobLogSpill(log, data, length - log->ringCapacity);
+        data += length - log->ringCapacity;
+        length = log->ringCapacity;
+        log->ringStart = 0;
+    }
+    //make room, spilling at least half the ring at a time so disk writes are batched
+    else if(log->ringLength + length > (size_t) log->ringCapacity){
+        int count = log->ringLength + length - log->ringCapacity;
+        if(count < log->ringCapacity / 2){
+            count = log->ringCapacity / 2;
+        }
+        spillJobLogRing(log, count);
+    }
+    //copy into ring after its newest byte, wrapping around if needed
+    int end = (log->ringStart + log->ringLength) % log->ringCapacity;
+    int firstLength = log->ringCapacity - end;
+    if((size_t) firstLength > length){
+        firstLength = length;
+    }
+    memcpy(&log->ring[end], data, firstLength);
+    memcpy(log->ring, data + firstLength, length - firstLength);
+    log->ringLength += length;
+}
+
+//copies up to length bytes of output of log starting at offset into buffer
+//returns the number of bytes copied
+size_t readJobLog(struct JobLog *log, uint64_t offset, char *buffer, size_t length){
+    if(offset >= log->totalBytes){
+        return 0;
+    }
+    if(offset + length > log->totalBytes){
+        length = log->totalBytes - offset;
+    }
+    size_t copied = 0;
+    //older part is in the spill file
+    if(offset < log->spilledBytes){
+        size_t spillLength = length;
+        if(offset + spillLength > log->spilledBytes){
+            spillLength = log->spilledBytes - offset;
+        }
+        char path[512];
+        int fileDescriptor = getJobLogSpillPath(log, path) == TRUE ? open(path, O_RDONLY | O_CLOEXEC) : -1;
+        ssize_t readCount = fileDescriptor == -1 ? -1 : pread(fileDescriptor, buffer, spillLength, offset);
+        if(fileDescriptor != -1){
+            close(fileDescriptor);
+        }
+        //fill anything missing from the spill file with zeros, so offsets still line up
+        if(readCount < (ssize_t) spillLength){
+            memset(buffer + (readCount > 0 ? readCount : 0), 0, spillLength - (readCount > 0 ? readCount : 0));
+        }
+        copied = spillLength;
+    }
+    //newer part is in the ring
+    while(copied < length){
+        int ringIndex = (log->ringStart + (offset + copied - log->spilledBytes)) % log->ringCapacity;
+        size_t pieceLength = log->ringCapacity - ringIndex;
+        if(pieceLength > length - copied){
+            pieceLength = length - copied;
+        }
+        memcpy(buffer + copied, &log->ring[ringIndex], pieceLength);
+        copied += pieceLength;
+    }
+    return copied;
+}
+
+//removes log from the list of job logs, deleting its spill file and freeing its memory
+void destroyJobLog(struct JobLog *log){
+    struct JobLog *previous = NULL;
+    struct JobLog *current = jobLogs.head;
+    while(current != log){
+        previous = current;
+        current = current->next;
+    }
+    if(previous == NULL){
+        jobLogs.head = log->next;
+    }
+    else{
+        previous->next = log->next;
+    }
+    if(jobLogs.tail == log){
+        jobLogs.tail = previous;
+    }
+    if(log->pipeFileDescriptor != -1){
+        epoll_ctl(jobLogs.epollFileDescriptor, EPOLL_CTL_DEL, log->pipeFileDescriptor, NULL);
+        close(log->pipeFileDescriptor);
+    }
+    else{
+        jobLogs.finishedCount--;
+    }
+    if(log->spilledBytes > 0){
+        char path[512];
+        if(getJobLogSpillPath(log, path) == TRUE){
+            unlink(path);
+        }
+    }
+    if(log->ringCapacity > 0){
+        free(log->ring);
+        jobLogs.ringMemory -= log->ringCapacity;
+    }
+    free(log->commandLine);
+    free(log);
+}
+
+//starts capturing output of a background job about to be started with commandLine
+//stores the write end of the pipe the job should write to in writeFileDescriptor
+//the caller closes it once the job has been forked, and sets the log's processId
+//returns NULL if the pipe couldn't be created
+struct JobLog * createJobLog(const char *commandLine, int *writeFileDescriptor){
+    int pipeFileDescriptors[2];
+    if(pipe2(pipeFileDescriptors, O_CLOEXEC) == -1){
+        return NULL;
+    }
+    //only the read end is non-blocking, so a job writing faster than the shell reads waits in the kernel instead of losing output
+    fcntl(pipeFileDescriptors[0], F_SETFL, O_NONBLOCK);
+    struct JobLog *log = malloc(sizeof(struct JobLog));
+    assert(log != NULL);
+    bzero(log, sizeof(struct JobLog));
+    log->sequenceNumber = jobLogs.nextSequenceNumber++;
+    log->commandLine = strdup(commandLine);
+    assert(log->commandLine != NULL);
+    //trailing whitespace is left over from removing '&'
+    int commandLength = strlen(log->commandLine);
+    while(commandLength > 0 && isspace(log->commandLine[commandLength - 1])){
+        log->commandLine[--commandLength] = '\0';
+    }
+    log->pipeFileDescriptor = pipeFileDescriptors[0];
+    struct epoll_event event;
+    event.events = EPOLLIN;
+    event.data.ptr = log;
+    epoll_ctl(jobLogs.epollFileDescriptor, EPOLL_CTL_ADD, log->pipeFileDescriptor, &event);
+    if(jobLogs.tail == NULL){
+        jobLogs.head = log;
+    }
+    else{
+        jobLogs.tail->next = log;
+    }
+    jobLogs.tail = log;
+    *writeFileDescriptor = pipeFileDescriptors[1];
+    return log;
+}
+
+//stops reading from the pipe of log, once everything writing to it has exited
+//the oldest finished logs are removed once there are more than JOB_LOG_HISTORY_LIMIT
+void finishJobLog(struct JobLog *log){
+    epoll_ctl(jobLogs.epollFileDescriptor, EPOLL_CTL_DEL, log->pipeFileDescriptor, NULL);
+    close(log->pipeFileDescriptor);
+    log->pipeFileDescriptor = -1;
+    jobLogs.finishedCount++;
+    struct JobLog *oldest = jobLogs.head;
+    while(jobLogs.finishedCount > JOB_LOG_HISTORY_LIMIT && oldest != NULL){
+        struct JobLog *next = oldest->next;
+        if(oldest->pipeFileDescriptor == -1){
+            destroyJobLog(oldest);
+        }
+        oldest = next;
+    }
+}
+
+//reads whatever jobs have written to their pipes since last time
+//called by waitForShellEvent() when any pipe is readable, so output is collected no matter what the shell is doing
+void pumpJobLogs(){
+    struct epoll_event events[JOB_LOG_EVENT_COUNT];
+    int eventCount = epoll_wait(jobLogs.epollFileDescriptor, events, JOB_LOG_EVENT_COUNT, 0);
+    static char buffer[JOB_LOG_RING_SIZE];
+    int i;
+    for(i = 0; i < eventCount; ++i){
+        struct JobLog *log = events[i].data.ptr;
+        //read a bounded amount from each pipe, so one busy job can't keep the shell from everything else
+        //anything left is picked up next time, since the pipe is still readable
+        int readRound;
+        for(readRound = 0; readRound < 4; ++readRound){
+            ssize_t readCount = read(log->pipeFileDescriptor, buffer, sizeof(buffer));
+            if(readCount > 0){
+                appendToJobLog(log, buffer, readCount);
+                continue;
+            }
+            if(readCount == 0 || (errno != EAGAIN && errno != EINTR)){
+                finishJobLog(log);
+            }
+            break;
+        }
+    }
+}
+
+//removes all job logs and their spill files
+//called before program exits
+void destroyJobLogs(){
+    while(jobLogs.head != NULL){
+        destroyJobLog(jobLogs.head);
+    }
+    if(jobLogs.spillDirectory[0] != '\0'){
+        rmdir(jobLogs.spillDirectory);
+    }
+}
+
+
+/*************************************
+* Admission control for background commands
+**************************************/
+
+//pressure on the system, sampled from /proc
+//cpu, memory and io are PSI 'some avg10' percentages - the share of the last 10 seconds
+//in which some task was stalled waiting for that resource - and load is the 1 minute load average
+struct Pressure{
+    double cpu;
+    double memory;
+    double io;
+    double load;
+    //FALSE if the kernel doesn't provide /proc/pressure, in which case only load is used
+    BOOL hasPressureStallInformation;
+};
+
+//background command waiting to be admitted
+struct QueuedCommand{
+    char *commandLine;
+    //deadline to give the command when it starts, if hasDeadline is TRUE
+    BOOL hasDeadline;
+    struct CommandDeadline deadline;
+    struct timespec queuedAt;
+    //working directory and 'joblog' setting when the command was queued, which it is started with
+    //directory is an O_PATH file descriptor, or -1 if it couldn't be opened
+    int directoryFileDescriptor;
+    BOOL isCapturing;
+    //journaled line the command is from, which stays open while it is queued
+    struct JournalLine *journalLine;
+    struct QueuedCommand *next;
+};
+
+//admission controller settings and state, set with 'admit'
+//while enabled, background commands are queued instead of started when any pressure is over its limit,
+//and started in order as pressure falls
+struct AdmissionController{
+    BOOL isEnabled;
+    //limits for each kind of pressure - 0 means no limit
+    double cpuLimit;
+    double memoryLimit;
+    double ioLimit;
+    double loadLimit;
+    //most background commands that can be running at once, 0 for no limit
+    int maxJobs;
+    //pressure is sampled once per interval, and at most burst commands are started each interval,
+    //since pressure from commands just started takes a while to show up
+    int burst;
+    struct timespec interval;
+    //start of the current interval, the pressure sampled then, and commands started since
+    struct timespec intervalStart;
+    struct Pressure pressure;
+    int admittedCount;
+    //timer that goes off every interval while commands are queued
+    int timer;
+    //queued commands, oldest first
+    struct QueuedCommand *head;
+    struct QueuedCommand *tail;
+    int queueLength;
+    //number of commands ever queued, and how long they waited (allocated when first needed)
+    long totalQueued;
+    struct CommandStats *waitStats;
+    //TRUE while queued commands are being started, so their pids are printed before the next prompt instead of straight away
+    BOOL isStartingQueued;
+};
+struct AdmissionController admissionController;
+
+//sets default limits for the admission controller, and creates its timer
+void initializeAdmissionController(){
+    long processorCount = sysconf(_SC_NPROCESSORS_ONLN);
+    if(processorCount < 1){
+        processorCount = 1;
+    }
+    bzero(&admissionController, sizeof(admissionController));
+    admissionController.cpuLimit = 90;
+    admissionController.memoryLimit = 10;
+    admissionController.ioLimit = 50;
+    admissionController.loadLimit = 2 * processorCount;
+    admissionController.burst = 2 * processorCount;
+    admissionController.interval.tv_nsec = 100 * 1000000;
+    admissionController.timer = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+}
+
+//reads the 'some avg10' value from the PSI file at path into value
+//returns FALSE if it couldn't be read
+BOOL readPressureFile(const char *path, double *value){
+    FILE *pressureFile = fopen(path, "re");
+    if(pressureFile == NULL){
+        return FALSE;
+    }
+    BOOL isRead = fscanf(pressureFile, "some avg10=%lf", value) == 1;
+    fclose(pressureFile);
+    return isRead;
+}
+
+//stores current pressure on the system in pressure
+void samplePressure(struct Pressure *pressure){
+    bzero(pressure, sizeof(struct Pressure));
+    pressure->hasPressureStallInformation = readPressureFile("/proc/pressure/cpu", &pressure->cpu);
+    if(pressure->hasPressureStallInformation == TRUE){
+        readPressureFile("/proc/pressure/memory", &pressure->memory);
+        readPressureFile("/proc/pressure/io", &pressure->io);
+    }
+    FILE *loadFile = fopen("/proc/loadavg", "re");
+    if(loadFile != NULL){
+        if(fscanf(loadFile, "%lf", &pressure->load) != 1){
+            pressure->load = 0;
+        }
+        fclose(loadFile);
+    }
+}
+
+//returns name of the first kind of pressure that is over its limit, or NULL if none are
+const char * getExceededPressure(const struct Pressure *pressure){
+    if(admissionController.cpuLimit > 0 && pressure->cpu > admissionController.cpuLimit){
+        return "cpu";
+    }
+    if(admissionController.memoryLimit > 0 && pressure->memory > admissionController.memoryLimit){
+        return "memory";
+    }
+    if(admissionController.ioLimit > 0 && pressure->io > admissionController.ioLimit){
+        return "io";
+    }
+    if(admissionController.loadLimit > 0 && pressure->load > admissionController.loadLimit){
+        return "load";
+    }
+    return NULL;
+}
+
+//returns number of background commands running
+int countBackgroundProcesses(struct BackgroundProcessList *backgroundProcessList){
+    int count = 0;
+    struct BackgroundProcessNode *node;
+    for(node = backgroundProcessList->head; node != NULL; node = node->next){
+        count++;
+    }
+    return count;
+}
+
+//returns TRUE if another background command can be started now
+//samples pressure again once the current interval is over
+//counts the command as started, so only call it when the command will be started if it returns TRUE
+BOOL hasAdmissionCapacity(struct BackgroundProcessList *backgroundProcessList){
+    struct timespec now;
+    getMonotonicTime(&now);
+    struct timespec intervalEnd;
+    addTimespec(&admissionController.intervalStart, &admissionController.interval, &intervalEnd);
+    if(compareTimespec(&now, &intervalEnd) >= 0){
+        admissionController.intervalStart = now;
+        admissionController.admittedCount = 0;
+        samplePressure(&admissionController.pressure);
+    }
+    if(getExceededPressure(&admissionController.pressure) != NULL || admissionController.admittedCount >= admissionController.burst){
+        return FALSE;
+    }
+    if(admissionController.maxJobs > 0 && countBackgroundProcesses(backgroundProcessList) >= admissionController.maxJobs){
+        return FALSE;
+    }
+    admissionController.admittedCount++;
+    return TRUE;
+}
+
+//returns TRUE if a new background command can be started straight away, instead of being queued
+//commands already waiting go first, so commands always start in the order they were given
+BOOL shouldAdmitCommand(struct BackgroundProcessList *backgroundProcessList){
+    if(admissionController.isEnabled == FALSE){
+        return TRUE;
+    }
+    return admissionController.head == NULL && hasAdmissionCapacity(backgroundProcessList);
+}
+
+//starts or stops the timer that starts queued commands, depending on whether any are queued
+void updateAdmissionTimer(){
+    struct itimerspec timerValue;
+    bzero(&timerValue, sizeof(timerValue));
+    if(admissionController.head != NULL){
+        timerValue.it_value = admissionController.interval;
+        timerValue.it_interval = admissionController.interval;
+    }
+    timerfd_settime(admissionController.timer, 0, &timerValue, NULL);
+}
+
+//adds background command in commandLine to the end of the admission queue
+//deadline is NULL if the command doesn't have one
+void queueCommand(const char *commandLine, const struct CommandDeadline *deadline){
+    struct QueuedCommand *queuedCommand = malloc(sizeof(struct QueuedCommand));
+    assert(queuedCommand != NULL);
+    bzero(queuedCommand, sizeof(struct QueuedCommand));
+    queuedCommand->commandLine = strdup(commandLine);
+    assert(queuedCommand->commandLine != NULL);
+    if(deadline != NULL){
+        queuedCommand->hasDeadline = TRUE;
+        queuedCommand->deadline = *deadline;
+    }
+    getMonotonicTime(&queuedCommand->queuedAt);
+    queuedCommand->directoryFileDescriptor = open(".", O_PATH | O_DIRECTORY | O_CLOEXEC);
+    queuedCommand->isCapturing = jobLogs.isCapturing;
+    queuedCommand->journalLine = holdJournalLine();
+    if(admissionController.tail == NULL){
+        admissionController.head = queuedCommand;
+    }
+    else{
+        admissionController.tail->next = queuedCommand;
+    }
+    admissionController.tail = queuedCommand;
+    admissionController.queueLength++;
+    admissionController.totalQueued++;
+    //timer is already running if other commands were queued
+    if(admissionController.queueLength == 1){
+        updateAdmissionTimer();
+    }
+}
+
+//removes the oldest command from the admission queue and returns it
+//the caller frees it with destroyQueuedCommand()
+struct QueuedCommand * dequeueCommand(){
+    struct QueuedCommand *queuedCommand = admissionController.head;
+    admissionController.head = queuedCommand->next;
+    if(admissionController.head == NULL){
+        admissionController.tail = NULL;
+        updateAdmissionTimer();
+    }
+    admissionController.queueLength--;
+    return queuedCommand;
+}
+
+//frees memory used by queuedCommand
+void destroyQueuedCommand(struct QueuedCommand *queuedCommand){
+    if(queuedCommand->directoryFileDescriptor != -1){
+        close(queuedCommand->directoryFileDescriptor);
+    }
+    free(queuedCommand->commandLine);
+    free(queuedCommand);
+}
+
+//defined with the other command execution functions,
+//but needed by waitForShellEvent() to start queued commands when the admission timer goes off
+void startQueuedCommands(struct BackgroundProcessList *backgroundProcessList);
+
+
+/*************************************
+* Passing file descriptors between processes
+**************************************/
+
+//sends data as one message on socket, with fileDescriptors attached using SCM_RIGHTS
+//returns FALSE if the message couldn't be sent
+BOOL sendWithFileDescriptors(int socket, const void *data, size_t dataLength, const int *fileDescriptors, int fileDescriptorCount){
+    struct iovec dataVector;
+    dataVector.iov_base = (void *) data;
+    dataVector.iov_len = dataLength;
+    struct msghdr message;
+    bzero(&message, sizeof(message));
+    message.msg_iov = &dataVector;
+    message.msg_iovlen = 1;
+    //control buffer aligned for cmsghdr, see: man 3 cmsg
+    union{
+        char buffer[CMSG_SPACE(sizeof(int) * 8)];
+        struct cmsghdr align;
+    } control;
+    if(fileDescriptorCount > 0){
+        assert(fileDescriptorCount <= 8);
+        message.msg_control = control.buffer;
+        message.msg_controllen = CMSG_SPACE(sizeof(int) * fileDescriptorCount);
+        struct cmsghdr *controlMessage = CMSG_FIRSTHDR(&message);
+        controlMessage->cmsg_level = SOL_SOCKET;
+        controlMessage->cmsg_type = SCM_RIGHTS;
+        controlMessage->cmsg_len = CMSG_LEN(sizeof(int) * fileDescriptorCount);
+        memcpy(CMSG_DATA(controlMessage), fileDescriptors, sizeof(int) * fileDescriptorCount);
+    }
+    ssize_t bytesSent;
+    do{
+        bytesSent = sendmsg(socket, &message, MSG_NOSIGNAL);
+    } while(bytesSent == -1 && errno == EINTR);
+    return bytesSent == (ssize_t) dataLength;
+}
+
+//receives one message from socket into data, storing any file descriptors
+//attached with SCM_RIGHTS in fileDescriptors (at most maxFileDescriptors, extra ones are closed)
+//received file descriptors are close on exec
+//returns number of bytes received, 0 if socket was closed, or -1 on error
+//if some of the file descriptors were dropped (the receiver has run out of them), the rest are closed
+//and it fails with errno EMSGSIZE, since the message can't be used without them
+ssize_t receiveWithFileDescriptors(int socket, void *data, size_t dataSize, int *fileDescriptors, int maxFileDescriptors, int *fileDescriptorCount){
+    struct iovec dataVector;
+    dataVector.iov_base = data;
+    dataVector.iov_len = dataSize;
+    struct msghdr message;
+    bzero(&message, sizeof(message));
+    message.msg_iov = &dataVector;
+    message.msg_iovlen = 1;
+    union{
+        char buffer[CMSG_SPACE(sizeof(int) * 8)];
+        struct cmsghdr align;
+    } control;
+    message.msg_control = control.buffer;
+    message.msg_controllen = sizeof(control.buffer);
+    *fileDescriptorCount = 0;
+    ssize_t bytesReceived;
+    do{
+        bytesReceived = recvmsg(socket, &message, MSG_CMSG_CLOEXEC);
+    } while(bytesReceived == -1 && errno == EINTR);
+    if(bytesReceived == -1){
+        return -1;
+    }
+    struct cmsghdr *controlMessage;
+    for(controlMessage = CMSG_FIRSTHDR(&message); controlMessage != NULL; controlMessage = CMSG_NXTHDR(&message, controlMessage)){
+        if(controlMessage->cmsg_level != SOL_SOCKET || controlMessage->cmsg_type != SCM_RIGHTS){
+            continue;
+        }
+        int receivedCount = (controlMessage->cmsg_len - CMSG_LEN(0)) / sizeof(int);
+        int *received = (int *) CMSG_DATA(controlMessage);
+        int i;
+        for(i = 0; i < receivedCount; ++i){
+            if(*fileDescriptorCount < maxFileDescriptors){
+                fileDescriptors[(*fileDescriptorCount)++] = received[i];
+            }
+            else{
+                close(received[i]);
+            }
+        }
+    }
+    if((message.msg_flags & MSG_CTRUNC) != 0){
+        int i;
+        for(i = 0; i < *fileDescriptorCount; ++i){
+            close(fileDescriptors[i]);
+        }
+        *fileDescriptorCount = 0;
+        errno = EMSGSIZE;
+        return -1;
+    }
+    return bytesReceived;
+}
+
+
+/*************************************
+* Fork server status functions
+**************************************/
+
+//number of buckets in the table of commands started by the fork server
+#define FORK_SERVER_TABLE_SIZE 256
+//largest request sent to the fork server - commands that don't fit (with their environment) are started by forking the shell
+#define FORK_SERVER_MESSAGE_SIZE (128 * 1024)
+//returned by spawnWithForkServer() when the shell should fork the command itself
+#define FORK_SERVER_NOT_USED -2
+//types of message sent back by the fork server
+#define FORK_SERVER_STARTED 1
+#define FORK_SERVER_FINISHED 2
+
+//request for the fork server to start a command
+//followed by the working directory, then argumentCount arguments and environmentCount environment variables,
+//each null terminated, with the command's standard input, output and error attached
+struct ForkServerRequest{
+    uint32_t requestId;
+    uint32_t argumentCount;
+    uint32_t environmentCount;
+    int32_t isBackgroundCommand;
+    int32_t isProcessGroup;
+};
+
+//message from the fork server: either a requested command was started (processId is -1, with errno in errorCode, if fork failed),
+//or a command it started has finished, with its wait status and resource usage
+struct ForkServerResponse{
+    int32_t type;
+    uint32_t requestId;
+    int32_t processId;
+    int32_t errorCode;
+    int32_t status;
+    struct rusage usage;
+};
+
+//wait status stored for a command whose real status can't be known, because the fork server
+//stopped before reporting it, or it was reaped by someone else
+//it is neither an exit nor a signal, so it is reported as unknown, and reads as a failure anywhere else
+#define LOST_PROCESS_STATUS -1
+
+//command started by the fork server
+//it is the fork server's child, not the shell's, so its status comes from the fork server's messages
+struct ForkServerProcess{
+    pid_t processId;
+    BOOL hasFinished;
+    int status;
+    struct rusage usage;
+    struct ForkServerProcess *next;
+};
+
+//fork server started with --fork-server
+struct ForkServer{
+    //shell's end of the socket, -1 if the fork server isn't running
+    int socket;
+    uint32_t nextRequestId;
+    //commands started by the fork server that haven't been reaped yet, hashed by pid
+    struct ForkServerProcess *processes[FORK_SERVER_TABLE_SIZE];
+};
+
+struct ForkServer forkServer = {.socket = -1};
+
+//returns the link pointing to the table entry for processId, so it can be removed, or NULL if there isn't one
+struct ForkServerProcess **findForkServerProcess(pid_t processId){
+    struct ForkServerProcess **link = &forkServer.processes[processId % FORK_SERVER_TABLE_SIZE];
+    while(*link != NULL){
+        if((*link)->processId == processId){
+            return link;
+        }
+        link = &(*link)->next;
+    }
+    return NULL;
+}
+
+//adds command started by the fork server to the table, so reapChild() knows to wait for its message
+void addForkServerProcess(pid_t processId){
+    struct ForkServerProcess *process = calloc(1, sizeof(struct ForkServerProcess));
+    assert(process != NULL);
+    process->processId = processId;
+    struct ForkServerProcess **bucket = &forkServer.processes[processId % FORK_SERVER_TABLE_SIZE];
+    process->next = *bucket;
+    *bucket = process;
+}
+
+//stops using the fork server after it has exited, so commands are started by forking the shell again
+//commands it started can't be waited for anymore, so they are treated like children that are already gone
+void stopForkServer(){
+    printf("fork server stopped, starting commands directly\n");
+    close(forkServer.socket);
+    forkServer.socket = -1;
+    //statuses of commands still running are lost, so drop them from the table
+    //reapChild() then finds they aren't the shell's children, and reports their status as lost
+    //(keeping them would hide any later command the shell forks that gets the same pid)
+    int i;
+    for(i = 0; i < FORK_SERVER_TABLE_SIZE; ++i){
+        struct ForkServerProcess **link = &forkServer.processes[i];
+        while(*link != NULL){
+            struct ForkServerProcess *process = *link;
+            if(process->hasFinished == TRUE){
+                link = &process->next;
+                continue;
+            }
+            *link = process->next;
+            free(process);
+        }
+    }
+}
+
+//records the status of a finished command from the fork server's message
+void handleForkServerResponse(const struct ForkServerResponse *response){
+    if(response->type != FORK_SERVER_FINISHED){
+        return;
+    }
+    struct ForkServerProcess **link = findForkServerProcess(response->processId);
+    if(link == NULL){
+        return;
+    }
+    (*link)->hasFinished = TRUE;
+    (*link)->status = response->status;
+    (*link)->usage = response->usage;
+}
+
+//handles messages from the fork server until there are none left, without blocking
+void readForkServerResponses(){
+    struct ForkServerResponse response;
+    int fileDescriptorCount;
+    ssize_t bytesReceived;
+    while(forkServer.socket != -1 && (bytesReceived = receiveWithFileDescriptors(forkServer.socket, &response, sizeof(response), NULL, 0, &fileDescriptorCount)) != -1){
+        if(bytesReceived == 0){
+            stopForkServer();
+        }
+        else if(bytesReceived == sizeof(response)){
+            handleForkServerResponse(&response);
+        }
+    }
+}
+
+
+/*************************************
+* Waiting for events
+**************************************/
+
+//checks if child process has finished without blocking
+//returns TRUE and stores waitpid status in status if it has
+//the child's resource usage is stored in usage, unless it is NULL
+BOOL reapChild(pid_t childProcessId, int *status, struct rusage *usage){
+    //commands started by the fork server are reaped by it, and their status is sent to the shell
+    struct ForkServerProcess **link = findForkServerProcess(childProcessId);
+    if(link != NULL){
+        readForkServerResponses();
+        struct ForkServerProcess *process = *link;
+        if(process->hasFinished == FALSE){
+            return FALSE;
+        }
+        *status = process->status;
+        if(usage != NULL){
+            *usage = process->usage;
+        }
+        *link = process->next;
+        free(process);
+        return TRUE;
+    }
+    pid_t waitpidResult = wait4(childProcessId, status, WNOHANG, usage);
+    //child is already gone (or was never ours), so there is nothing left to wait for, and its status is unknown
+    if(waitpidResult == -1 && errno == ECHILD){
+        *status = LOST_PROCESS_STATUS;
+        return TRUE;
+    }
+    if(waitpidResult <= 0){
+        return FALSE;
+    }
+    return WIFEXITED(*status) || WIFSIGNALED(*status);
+}
+
+//checks if the background process in node has finished without blocking, reaping it the first time it has
+//returns TRUE and stores its waitpid status in status if it has
+BOOL reapBackgroundProcess(struct BackgroundProcessNode *node, struct BackgroundProcessList *backgroundProcessList, int *status){
+    if(node->hasFinished == FALSE){
+        if(reapChild(node->processId, &node->finishedStatus, NULL) == FALSE){
+            return FALSE;
+        }
+        node->hasFinished = TRUE;
+        node->finishOrder = backgroundProcessList->finishCount++;
+        //its pid can be reused once it has been reaped, so its deadline must not signal it any more
+        node->hasDeadline = FALSE;
+    }
+    *status = node->finishedStatus;
+    return TRUE;
+}
+
+//reaps every background process that has finished, so they are numbered in the order they finished
+//called whenever a child process changes state
+void reapBackgroundProcesses(struct BackgroundProcessList *backgroundProcessList){
+    struct BackgroundProcessNode *node;
+    int status;
+    for(node = backgroundProcessList->head; node != NULL; node = node->next){
+        reapBackgroundProcess(node, backgroundProcessList, &status);
+    }
+}
+
+//waits until something the shell is waiting for happens, or timeoutMilliseconds pass (-1 to wait as long as it takes):
+//a child process changes state, inputFileDescriptor can be read or timerFileDescriptor expires
+//(either can be -1 to not wait for it), or a signal is caught
+//background deadlines that expire while waiting, output of background jobs being captured,
+//queued background commands that can now be started, and journal records waiting to be synced are handled here,
+//so they are dealt with no matter what the shell is doing
+//returns SHELL_EVENT_* flags for what happened - 0 means interrupted by a signal, timed out, or woken up to sync the journal
+int pollShellEvents(int inputFileDescriptor, int timerFileDescriptor, struct BackgroundProcessList *backgroundProcessList, int timeoutMilliseconds){
+    struct pollfd pollFileDescriptors[7];
+    int pollCount = 0;
+    pollFileDescriptors[pollCount].fd = signalEventPipe[0];
+    pollFileDescriptors[pollCount++].events = POLLIN;
+    pollFileDescriptors[pollCount].fd = backgroundDeadlineTimer;
+    pollFileDescriptors[pollCount++].events = POLLIN;
+    pollFileDescriptors[pollCount].fd = admissionController.timer;
+    pollFileDescriptors[pollCount++].events = POLLIN;
+    int inputIndex = -1;
+    if(inputFileDescriptor != -1){
+        inputIndex = pollCount;
+        pollFileDescriptors[pollCount].fd = inputFileDescriptor;
+        pollFileDescriptors[pollCount++].events = POLLIN;
+    }
+    int timerIndex = -1;
+    if(timerFileDescriptor != -1){
+        timerIndex = pollCount;
+        pollFileDescriptors[pollCount].fd = timerFileDescriptor;
+        pollFileDescriptors[pollCount++].events = POLLIN;
+    }
+    int jobLogIndex = -1;
+    if(jobLogs.epollFileDescriptor != -1){
+        jobLogIndex = pollCount;
+        pollFileDescriptors[pollCount].fd = jobLogs.epollFileDescriptor;
+        pollFileDescriptors[pollCount++].events = POLLIN;
+    }
+    int forkServerIndex = -1;
+    if(forkServer.socket != -1){
+        forkServerIndex = pollCount;
+        pollFileDescriptors[pollCount].fd = forkServer.socket;
+        pollFileDescriptors[pollCount++].events = POLLIN;
+    }
+    //wake up in time to sync journal records, returning 0 as if interrupted
+    int journalTimeout = syncJournalIfDue();
+    if(journalTimeout != -1 && (timeoutMilliseconds == -1 || journalTimeout < timeoutMilliseconds)){
+        timeoutMilliseconds = journalTimeout;
+    }
+    int pollResult = poll(pollFileDescriptors, pollCount, timeoutMilliseconds);
+    if(pollResult <= 0){
+        return 0;
+    }
+    int events = 0;
+    //empty pipe - each byte is just a notification that a signal was received
+    if(pollFileDescriptors[0].revents != 0){
+        char notifications[64];
+        while(read(signalEventPipe[0], notifications, sizeof(notifications)) > 0){
+        }
+        reapBackgroundProcesses(backgroundProcessList);
+        events |= SHELL_EVENT_CHILD;
+    }
+    if(pollFileDescriptors[1].revents != 0){
+        uint64_t expirations;
+        read(backgroundDeadlineTimer, &expirations, sizeof(expirations));
+        expireBackgroundDeadlines(backgroundProcessList);
+    }
+    if(pollFileDescriptors[2].revents != 0){
+        uint64_t expirations;
+        read(admissionController.timer, &expirations, sizeof(expirations));
+        startQueuedCommands(backgroundProcessList);
+    }
+    //errors and hangups count as input, so the reader finds out about them
+    if(inputIndex != -1 && pollFileDescriptors[inputIndex].revents != 0){
+        events |= SHELL_EVENT_INPUT;
+    }
+    if(timerIndex != -1 && pollFileDescriptors[timerIndex].revents != 0){
+        uint64_t expirations;
+        read(timerFileDescriptor, &expirations, sizeof(expirations));
+        events |= SHELL_EVENT_TIMER;
+    }
+    if(jobLogIndex != -1 && pollFileDescriptors[jobLogIndex].revents != 0){
+        pumpJobLogs();
+    }
+    //commands started by the fork server finishing count the same as the shell's own children
+    if(forkServerIndex != -1 && pollFileDescriptors[forkServerIndex].revents != 0){
+        readForkServerResponses();
+        reapBackgroundProcesses(backgroundProcessList);
+        events |= SHELL_EVENT_CHILD;
+    }
+    return events;
+}
+
+//blocks until something the shell is waiting for happens, see pollShellEvents()
+int waitForShellEvent(int inputFileDescriptor, int timerFileDescriptor, struct BackgroundProcessList *backgroundProcessList){
+    return pollShellEvents(inputFileDescriptor, timerFileDescriptor, backgroundProcessList, -1);
+}
+
+/*************************************
+* Executable index for tab completion
+**************************************/
+
+//names of built in commands, offered by command completion
+//alongside the executables found in PATH
+const char *builtinCommandNames[] = {"cd", "status", "exit", "timeout", "stats", "wait", "taskrun", "joblog", "admit", NULL};
+
+//node in trie of executable names found in the directories in PATH
+//children are kept in a linked list sorted by character, so that
+//candidates are listed in alphabetical order
+struct ExecutableTrieNode{
+    char character;
+    //number of PATH directories (or built in commands) providing the name
+    //that ends at this node - 0 means no name ends here
+    int terminalCount;
+    //number of distinct names that end at this node or below it
+    int subtreeNameCount;
+    struct ExecutableTrieNode *firstChild;
+    struct ExecutableTrieNode *nextSibling;
+};
+
+//directory from PATH, and the executables found in it when it was last scanned
+struct ExecutableDirectory{
+    char *path;
+    //modification time of the directory when it was scanned - the directory
+    //only needs to be scanned again when this changes
+    struct timespec modificationTime;
+    BOOL isScanned;
+    //executable names found in the directory, kept so they
+    //can be removed from the trie when the directory changes
+    char **names;
+    int nameCount;
+    int nameCapacity;
+};
+
+//in-memory index of all executables in PATH
+//built the first time tab completion is used, then updated incrementally
+//by rescanning only the PATH directories that have changed
+struct ExecutableIndex{
+    struct ExecutableTrieNode root;
+    //value of PATH the directories were taken from
+    char *pathVariable;
+    struct ExecutableDirectory *directories;
+    int directoryCount;
+    BOOL isBuilt;
+};
+
+//global, since the index should persist between calls to getUserInput()
+struct ExecutableIndex executableIndex;
+
+//adds name to the trie, or increases the count of sources for the name if it already exists
+void insertIntoExecutableTrie(struct ExecutableTrieNode *root, const char *name){
+    //nodes visited, so subtree counts can be updated if this is a new name
+    struct ExecutableTrieNode *path[NAME_MAX + 2];
+    int depth = 0;
+    struct ExecutableTrieNode *node = root;
+    path[depth++] = node;
+    const char *currentChar;
+    for(currentChar = name; *currentChar != '\0' && depth <= NAME_MAX; ++currentChar){
+        //find child with current character, or the place it should be inserted to keep children sorted
+        struct ExecutableTrieNode **link = &node->firstChild;
+        while(*link != NULL && (unsigned char) (*link)->character < (unsigned char) *currentChar){
+            link = &(*link)->nextSibling;
+        }
+        if(*link == NULL || (*link)->character != *currentChar){
+            struct ExecutableTrieNode *child = malloc(sizeof(struct ExecutableTrieNode));
+            assert(child != NULL);
+            child->character = *currentChar;
+            child->terminalCount = 0;
+            child->subtreeNameCount = 0;
+            child->firstChild = NULL;
+            child->nextSibling = *link;
+            *link = child;
+        }
+        node = *link;
+        path[depth++] = node;
+    }
+    node->terminalCount++;
+    //name is new, so every node on the path has one more name below it
+    if(node->terminalCount == 1){
+        int i;
+        for(i = 0; i < depth; ++i){
+            path[i]->subtreeNameCount++;
+        }
+    }
+}
+
+//decreases the count of sources for name, and deletes it from the trie
+//once there are no sources left, freeing nodes that no longer lead to any name
+void removeFromExecutableTrie(struct ExecutableTrieNode *root, const char *name){
+    struct ExecutableTrieNode *path[NAME_MAX + 2];
+    int depth = 0;
+    struct ExecutableTrieNode *node = root;
+    path[depth++] = node;
+    const char *currentChar;
+    for(currentChar = name; *currentChar != '\0' && depth <= NAME_MAX; ++currentChar){
+        node = node->firstChild;
+        while(node != NULL && node->character != *currentChar){
+            node = node->nextSibling;
+        }
+        //name isn't in the trie
+        if(node == NULL){
+            return;
+        }
+        path[depth++] = node;
+    }
+    if(node->terminalCount == 0){
+        return;
+    }
+    node->terminalCount--;
+    //still provided by another directory
+    if(node->terminalCount > 0){
+        return;
+    }
+    int i;
+    for(i = 0; i < depth; ++i){
+        path[i]->subtreeNameCount--;
+    }
+    //prune empty nodes from the bottom up, never freeing the root
+    for(i = depth - 1; i > 0 && path[i]->subtreeNameCount == 0; --i){
+        struct ExecutableTrieNode **link = &path[i - 1]->firstChild;
+        while(*link != path[i]){
+            link = &(*link)->nextSibling;
+        }
+        *link = path[i]->nextSibling;
+        free(path[i]);
+    }
+}
+
+//frees all nodes below node
+void destroyExecutableTrieChildren(struct ExecutableTrieNode *node){
+    struct ExecutableTrieNode *child = node->firstChild;
+    while(child != NULL){
+        struct ExecutableTrieNode *next = child->nextSibling;
+        destroyExecutableTrieChildren(child);
+        free(child);
+        child = next;
+    }
+    node->firstChild = NULL;
+    node->subtreeNameCount = 0;
+    node->terminalCount = 0;
+}
+
+//returns the node reached by following prefix from root
+//or NULL if no name starts with prefix
+struct ExecutableTrieNode * findExecutableTrieNode(struct ExecutableTrieNode *root, const char *prefix, int prefixLength){
+    struct ExecutableTrieNode *node = root;
+    int i;
+    for(i = 0; i < prefixLength && node != NULL; ++i){
+        node = node->firstChild;
+        while(node != NULL && node->character != prefix[i]){
+            node = node->nextSibling;
+        }
+    }
+    return node;
+}
+
+//removes names found in directory from the trie and forgets them
+void clearExecutableDirectory(struct ExecutableDirectory *directory){
+    int i;
+    for(i = 0; i < directory->nameCount; ++i){
+        removeFromExecutableTrie(&executableIndex.root, directory->names[i]);
+        free(directory->names[i]);
+    }
+    free(directory->names);
+    directory->names = NULL;
+    directory->nameCount = 0;
+    directory->nameCapacity = 0;
+    directory->isScanned = FALSE;
+}
+
+//reads the executables in directory and adds them to the trie
+//directories that don't exist or can't be read are treated as empty
+void scanExecutableDirectory(struct ExecutableDirectory *directory){
+    directory->isScanned = TRUE;
+    directory->modificationTime.tv_sec = 0;
+    directory->modificationTime.tv_nsec = 0;
+    DIR *directoryStream = opendir(directory->path);
+    if(directoryStream == NULL){
+        return;
+    }
+    int directoryFileDescriptor = dirfd(directoryStream);
+    //get modification time before reading entries, so changes made
+    //while scanning will cause another scan next time
+    struct stat directoryInfo;
+    if(fstat(directoryFileDescriptor, &directoryInfo) == 0){
+        directory->modificationTime = directoryInfo.st_mtim;
+    }
+    struct dirent *entry;
+    while((entry = readdir(directoryStream)) != NULL){
+        //directories can't be executed, so skip them without calling stat
+        if(entry->d_type == DT_DIR || entry->d_name[0] == '.'){
+            continue;
+        }
+        //follow symlinks, since most of PATH is links on some systems
+        struct stat entryInfo;
+        if(fstatat(directoryFileDescriptor, entry->d_name, &entryInfo, 0) != 0){
+            continue;
+        }
+        if(!S_ISREG(entryInfo.st_mode) || (entryInfo.st_mode & (S_IXUSR | S_IXGRP | S_IXOTH)) == 0){
+            continue;
+        }
+        if(directory->nameCount == directory->nameCapacity){
+            directory->nameCapacity = directory->nameCapacity == 0 ? 64 : directory->nameCapacity * 2;
+            directory->names = realloc(directory->names, sizeof(char *) * directory->nameCapacity);
+            assert(directory->names != NULL);
+        }
+        char *name = strdup(entry->d_name);
+        assert(name != NULL);
+        directory->names[directory->nameCount++] = name;
+        insertIntoExecutableTrie(&executableIndex.root, name);
+    }
+    closedir(directoryStream);
+}
+
+//replaces list of directories with those in pathVariable
+//directories that are still in PATH keep their scanned names,
+//so only new directories have to be read
+void setExecutableIndexPath(const char *pathVariable){
+    //count directories - PATH is separated by ':'
+    int newDirectoryCount = 1;
+    const char *currentChar;
+    for(currentChar = pathVariable; *currentChar != '\0'; ++currentChar){
+        if(*currentChar == ':'){
+            newDirectoryCount++;
+        }
+    }
+    struct ExecutableDirectory *newDirectories = calloc(newDirectoryCount, sizeof(struct ExecutableDirectory));
+    assert(newDirectories != NULL);
+
+    const char *directoryStart = pathVariable;
+    int i;
+    for(i = 0; i < newDirectoryCount; ++i){
+        const char *directoryEnd = strchr(directoryStart, ':');
+        if(directoryEnd == NULL){
+            directoryEnd = directoryStart + strlen(directoryStart);
+        }
+        int directoryLength = directoryEnd - directoryStart;
+        //empty entry in PATH means the current directory
+        char *path = directoryLength == 0 ? strdup(".") : strndup(directoryStart, directoryLength);
+        assert(path != NULL);
+        //reuse existing entry for this directory if there is one
+        int j;
+        for(j = 0; j < executableIndex.directoryCount; ++j){
+            if(executableIndex.directories[j].path != NULL && strcmp(executableIndex.directories[j].path, path) == 0){
+                newDirectories[i] = executableIndex.directories[j];
+                //mark as moved, so it isn't cleared below
+                executableIndex.directories[j].path = NULL;
+                free(path);
+                break;
+            }
+        }
+        if(j == executableIndex.directoryCount){
+            newDirectories[i].path = path;
+        }
+        directoryStart = *directoryEnd == ':' ? directoryEnd + 1 : directoryEnd;
+    }
+    //remove names from directories no longer in PATH
+    for(i = 0; i < executableIndex.directoryCount; ++i){
+        if(executableIndex.directories[i].path != NULL){
+            clearExecutableDirectory(&executableIndex.directories[i]);
+            free(executableIndex.directories[i].path);
+        }
+    }
+    free(executableIndex.directories);
+    executableIndex.directories = newDirectories;
+    executableIndex.directoryCount = newDirectoryCount;
+
+    free(executableIndex.pathVariable);
+    executableIndex.pathVariable = strdup(pathVariable);
+    assert(executableIndex.pathVariable != NULL);
+}
+
+//makes sure the executable index matches PATH and the contents of its directories
+//called before each completion - when nothing has changed this is just one stat() per PATH directory
+void refreshExecutableIndex(){
+    if(executableIndex.isBuilt == FALSE){
+        executableIndex.root.character = '\0';
+        executableIndex.root.terminalCount = 0;
+        executableIndex.root.subtreeNameCount = 0;
+        executableIndex.root.firstChild = NULL;
+        executableIndex.root.nextSibling = NULL;
+        executableIndex.pathVariable = NULL;
+        executableIndex.directories = NULL;
+        executableIndex.directoryCount = 0;
+        //built in commands never change, so only need to be added once
+        int i;
+        for(i = 0; builtinCommandNames[i] != NULL; ++i){
+            insertIntoExecutableTrie(&executableIndex.root, builtinCommandNames[i]);
+        }
+        executableIndex.isBuilt = TRUE;
+    }
+    const char *pathVariable = getenv("PATH");
+    if(pathVariable == NULL){
+        pathVariable = "";
+    }
+    if(executableIndex.pathVariable == NULL || strcmp(executableIndex.pathVariable, pathVariable) != 0){
+        setExecutableIndexPath(pathVariable);
+    }
+    //rescan directories that are new or whose contents have changed
+    int i;
+    for(i = 0; i < executableIndex.directoryCount; ++i){
+        struct ExecutableDirectory *directory = &executableIndex.directories[i];
+        struct stat directoryInfo;
+        BOOL exists = stat(directory->path, &directoryInfo) == 0;
+        if(directory->isScanned == TRUE){
+            if(exists && directoryInfo.st_mtim.tv_sec == directory->modificationTime.tv_sec && directoryInfo.st_mtim.tv_nsec == directory->modificationTime.tv_nsec){
+                continue;
+            }
+            //directory that didn't exist still doesn't
+            if(!exists && directory->nameCount == 0 && directory->modificationTime.tv_sec == 0){
+                continue;
+            }
+            clearExecutableDirectory(directory);
+        }
+        scanExecutableDirectory(directory);
+    }
+}
+
+
+/*************************************
+* Get user input functions
+**************************************/
+
+//terminal settings from before line editing started,
+//restored before commands are run
+struct termios originalTerminalSettings;
+
+//buffered input read from standard input
+//stdio isn't used, so the shell can wait for input and other events at the same time
+struct InputReader{
+    char buffer[INPUT_BUFFER_SIZE];
+    //index of next unread byte
+    int start;
+    //index after last byte read
+    int end;
+};
+
+//global, since input read ahead has to be kept between commands
+struct InputReader inputReader;
+
+//returns next byte from standard input, or -1 at end of input
+//background deadlines are still enforced while waiting for input
+int readInputByte(struct BackgroundProcessList *backgroundProcessList){
+    while(inputReader.start == inputReader.end){
+        if((waitForShellEvent(STDIN_FILENO, -1, backgroundProcessList) & SHELL_EVENT_INPUT) == 0){
+            continue;
+        }
+        ssize_t bytesRead = read(STDIN_FILENO, inputReader.buffer, INPUT_BUFFER_SIZE);
+        if(bytesRead == -1 && (errno == EINTR || errno == EAGAIN)){
+            continue;
+        }
+        if(bytesRead <= 0){
+            return -1;
+        }
+        inputReader.start = 0;
+        inputReader.end = bytesRead;
+    }
+    return (unsigned char) inputReader.buffer[inputReader.start++];
+}
+
+void writePrompt(){
+	printf(PROMPT_STRING);
+}
+
+//line being edited by the interactive line editor
+struct LineEditor{
+    char *buffer;
+    int length;
+    //index in buffer where typed characters are inserted
+    int cursor;
+};
+
+//redraws prompt and line, and moves the terminal cursor to the editor's cursor
+void refreshLine(struct LineEditor *editor){
+    //go to start of line, redraw, and erase anything left over to the right
+    printf("\r%s%.*s\x1b[K\r", PROMPT_STRING, editor->length, editor->buffer);
+    int cursorColumn = strlen(PROMPT_STRING) + editor->cursor;
+    if(cursorColumn > 0){
+        printf("\x1b[%dC", cursorColumn);
+    }
+    fflush(stdout);
+}
+
+//inserts text at cursor, as long as it fits in the buffer
+void insertIntoLine(struct LineEditor *editor, const char *text, int textLength){
+    //leave room for null char
+    if(editor->length + textLength > COMMAND_LINE_MAX_LENGTH - 2){
+        return;
+    }
+    memmove(&editor->buffer[editor->cursor + textLength], &editor->buffer[editor->cursor], editor->length - editor->cursor);
+    memcpy(&editor->buffer[editor->cursor], text, textLength);
+    editor->length += textLength;
+    editor->cursor += textLength;
+    editor->buffer[editor->length] = '\0';
+}
+
+//deletes character at index from line
+void deleteFromLine(struct LineEditor *editor, int index){
+    if(index < 0 || index >= editor->length){
+        return;
+    }
+    memmove(&editor->buffer[index], &editor->buffer[index + 1], editor->length - index - 1);
+    editor->length--;
+    editor->buffer[editor->length] = '\0';
+    if(editor->cursor > index){
+        editor->cursor--;
+    }
+}
+
+//used with qsort to sort completion candidates alphabetically
+int compareStrings(const void *a, const void *b){
+    return strcmp(*(char * const *) a, *(char * const *) b);
+}
+
+//prints candidates in columns fitting the terminal width
+//totalCount is the number of candidates, which may be more than candidateCount if the list was truncated
+void printCompletionCandidates(char **candidates, int candidateCount, int totalCount){
+    int longest = 0;
+    int i;
+    for(i = 0; i < candidateCount; ++i){
+        int length = strlen(candidates[i]);
+        if(length > longest){
+            longest = length;
+        }
+    }
+    int terminalWidth = 80;
+    struct winsize windowSize;
+    if(ioctl(STDOUT_FILENO, TIOCGWINSZ, &windowSize) == 0 && windowSize.ws_col > 0){
+        terminalWidth = windowSize.ws_col;
+    }
+    int columnWidth = longest + 2;
+    int columnCount = terminalWidth / columnWidth;
+    if(columnCount < 1){
+        columnCount = 1;
+    }
+    printf("\n");
+    for(i = 0; i < candidateCount; ++i){
+        BOOL isLastInRow = (i + 1) % columnCount == 0 || i == candidateCount - 1;
+        printf("%-*s", isLastInRow ? 0 : columnWidth, candidates[i]);
+        if(isLastInRow){
+            printf("\n");
+        }
+    }
+    if(totalCount > candidateCount){
+        printf("... and %d more\n", totalCount - candidateCount);
+    }
+}
+
+//adds names below node to candidates in alphabetical order, until limit is reached
+//name holds the characters leading to node, and nameLength is its length
+void collectTrieNames(struct ExecutableTrieNode *node, char *name, int nameLength, char **candidates, int *candidateCount, int limit){
+    if(*candidateCount >= limit){
+        return;
+    }
+    if(node->terminalCount > 0){
+        name[nameLength] = '\0';
+        candidates[*candidateCount] = strdup(name);
+        assert(candidates[*candidateCount] != NULL);
+        (*candidateCount)++;
+    }
+    struct ExecutableTrieNode *child;
+    for(child = node->firstChild; child != NULL && nameLength < NAME_MAX; child = child->nextSibling){
+        name[nameLength] = child->character;
+        collectTrieNames(child, name, nameLength + 1, candidates, candidateCount, limit);
+    }
+}
+
+//completes the command name in editor from the executable index
+//word is the partial command name before the cursor
+void completeCommandName(struct LineEditor *editor, const char *word, int wordLength){
+    refreshExecutableIndex();
+    struct ExecutableTrieNode *node = findExecutableTrieNode(&executableIndex.root, word, wordLength);
+    if(node == NULL){
+        return;
+    }
+    //extend the word as long as there is only one way to continue it
+    char extension[NAME_MAX + 1];
+    int extensionLength = 0;
+    while(node->terminalCount == 0 && node->firstChild != NULL && node->firstChild->nextSibling == NULL && wordLength + extensionLength < NAME_MAX){
+        node = node->firstChild;
+        extension[extensionLength++] = node->character;
+    }
+    //unique match, so finish the word
+    if(node->subtreeNameCount == 1 && node->terminalCount > 0){
+        extension[extensionLength++] = ' ';
+    }
+    if(extensionLength > 0){
+        insertIntoLine(editor, extension, extensionLength);
+        return;
+    }
+    //nothing could be added, so show what the choices are
+    char name[NAME_MAX + 1];
+    memcpy(name, word, wordLength);
+    char **candidates = malloc(sizeof(char *) * COMPLETION_DISPLAY_LIMIT);
+    assert(candidates != NULL);
+    int candidateCount = 0;
+    collectTrieNames(node, name, wordLength, candidates, &candidateCount, COMPLETION_DISPLAY_LIMIT);
+    printCompletionCandidates(candidates, candidateCount, node->subtreeNameCount);
+    int i;
+    for(i = 0; i < candidateCount; ++i){
+        free(candidates[i]);
+    }
+    free(candidates);
+}
+
+//completes the file or directory name in editor
+//word is the partial path before the cursor
+void completePath(struct LineEditor *editor, const char *word, int wordLength){
+    //split word into directory to search and the start of the file name
+    const char *lastSlash = NULL;
+    int i;
+    for(i = 0; i < wordLength; ++i){
+        if(word[i] == '/'){
+            lastSlash = &word[i];
+        }
+    }
+    char directoryName[COMMAND_LINE_MAX_LENGTH];
+    const char *filePrefix = word;
+    if(lastSlash == NULL){
+        strcpy(directoryName, ".");
+    }
+    else{
+        int directoryLength = lastSlash - word + 1;
+        memcpy(directoryName, word, directoryLength);
+        directoryName[directoryLength] = '\0';
+        filePrefix = lastSlash + 1;
+    }
+    int filePrefixLength = wordLength - (filePrefix - word);
+
+    DIR *directoryStream = opendir(directoryName);
+    if(directoryStream == NULL){
+        return;
+    }
+    //collect matching names - directories get a trailing '/' so they can be told apart
+    char **candidates = NULL;
+    int candidateCount = 0;
+    int candidateCapacity = 0;
+    struct dirent *entry;
+    while((entry = readdir(directoryStream)) != NULL){
+        if(strncmp(entry->d_name, filePrefix, filePrefixLength) != 0){
+            continue;
+        }
+        //hidden files are only offered if the user started typing a '.'
+        if(entry->d_name[0] == '.' && filePrefixLength == 0){
+            continue;
+        }
+        if(strcmp(entry->d_name, ".") == 0 || strcmp(entry->d_name, "..") == 0){
+            continue;
+        }
+        BOOL isDirectory = entry->d_type == DT_DIR;
+        if(entry->d_type == DT_LNK || entry->d_type == DT_UNKNOWN){
+            struct stat entryInfo;
+            isDirectory = fstatat(dirfd(directoryStream), entry->d_name, &entryInfo, 0) == 0 && S_ISDIR(entryInfo.st_mode);
+        }
+        if(candidateCount == candidateCapacity){
+            candidateCapacity = candidateCapacity == 0 ? 16 : candidateCapacity * 2;
+            candidates = realloc(candidates, sizeof(char *) * candidateCapacity);
+            assert(candidates != NULL);
+        }
+        int nameLength = strlen(entry->d_name);
+        char *candidate = malloc(nameLength + 2);
+        assert(candidate != NULL);
+        strcpy(candidate, entry->d_name);
+        if(isDirectory){
+            strcat(candidate, "/");
+        }
+        candidates[candidateCount++] = candidate;
+    }
+    closedir(directoryStream);
+    if(candidateCount == 0){
+        return;
+    }
+    qsort(candidates, candidateCount, sizeof(char *), compareStrings);
+    //find how much all candidates have in common beyond what was typed
+    int commonLength = strlen(candidates[0]);
+    for(i = 1; i < candidateCount; ++i){
+        int j = filePrefixLength;
+        while(j < commonLength && candidates[i][j] == candidates[0][j]){
+            j++;
+        }
+        commonLength = j;
+    }
+    if(commonLength > filePrefixLength){
+        insertIntoLine(editor, &candidates[0][filePrefixLength], commonLength - filePrefixLength);
+        //finished file name, so move on to next argument
+        if(candidateCount == 1 && candidates[0][commonLength - 1] != '/'){
+            insertIntoLine(editor, " ", 1);
+        }
+    }
+    else if(candidateCount > 1){
+        int displayCount = candidateCount < COMPLETION_DISPLAY_LIMIT ? candidateCount : COMPLETION_DISPLAY_LIMIT;
+        printCompletionCandidates(candidates, displayCount, candidateCount);
+    }
+    for(i = 0; i < candidateCount; ++i){
+        free(candidates[i]);
+    }
+    free(candidates);
+}
+
+//returns TRUE if character is part of an operator separating commands in a command list (';', '&&', '||' or '&')
+BOOL isListOperatorCharacter(char character){
+    return character == ';' || character == '&' || character == '|';
+}
+
+//completes the word before the cursor
+//the first word of each command on the line is completed as a command name, unless it contains a '/'
+//other words are completed as file names
+void completeWord(struct LineEditor *editor){
+    int wordStart = editor->cursor;
+    while(wordStart > 0 && !isspace(editor->buffer[wordStart - 1]) && !isListOperatorCharacter(editor->buffer[wordStart - 1])){
+        wordStart--;
+    }
+    //first word of a command if there is nothing but whitespace before it, back to the start of the line
+    //or the operator ending the command before
+    BOOL isCommandName = TRUE;
+    int i;
+    for(i = wordStart - 1; i >= 0 && !isListOperatorCharacter(editor->buffer[i]); --i){
+        if(!isspace(editor->buffer[i])){
+            isCommandName = FALSE;
+            break;
+        }
+    }
+    char word[COMMAND_LINE_MAX_LENGTH];
+    int wordLength = editor->cursor - wordStart;
+    memcpy(word, &editor->buffer[wordStart], wordLength);
+    word[wordLength] = '\0';
+    if(isCommandName && strchr(word, '/') == NULL){
+        completeCommandName(editor, word, wordLength);
+    }
+    else{
+        completePath(editor, word, wordLength);
+    }
+}
+
+//reads a line from the terminal in raw mode, with basic line editing and tab completion
+//stores line without trailing newline in commandLineBuffer
+//returns FALSE if user ended input with control-d on an empty line
+BOOL readLineInteractive(char commandLineBuffer[COMMAND_LINE_MAX_LENGTH], struct BackgroundProcessList *backgroundProcessList){
+    struct LineEditor editor;
+    editor.buffer = commandLineBuffer;
+    editor.length = 0;
+    editor.cursor = 0;
+    fflush(stdout);
+    while(1){
+        int nextByte = readInputByte(backgroundProcessList);
+        //input closed
+        if(nextByte == -1){
+            return editor.length > 0;
+        }
+        char key = nextByte;
+        switch(key){
+            case '\r':
+            case '\n':
+                printf("\n");
+                return TRUE;
+            case '\t':
+                completeWord(&editor);
+                break;
+            //cancel line, like control-c in other shells
+            case CONTROL_KEY('c'):
+                printf("^C\n");
+                editor.length = 0;
+                editor.buffer[0] = '\0';
+                return TRUE;
+            //end input on empty line, otherwise delete under cursor
+            case CONTROL_KEY('d'):
+                if(editor.length == 0){
+                    printf("\n");
+                    return FALSE;
+                }
+                deleteFromLine(&editor, editor.cursor);
+                break;
+            case BACKSPACE_KEY:
+            case CONTROL_KEY('h'):
+                deleteFromLine(&editor, editor.cursor - 1);
+                break;
+            case CONTROL_KEY('a'):
+                editor.cursor = 0;
+                break;
+            case CONTROL_KEY('e'):
+                editor.cursor = editor.length;
+                break;
+            //erase everything before the cursor
+            case CONTROL_KEY('u'):
+                memmove(editor.buffer, &editor.buffer[editor.cursor], editor.length - editor.cursor);
+                editor.length -= editor.cursor;
+                editor.cursor = 0;
+                editor.buffer[editor.length] = '\0';
+                break;
+            //escape sequences for arrow, home, end and delete keys
+            case ESCAPE_KEY:{
+                int sequence[3];
+                if((sequence[0] = readInputByte(backgroundProcessList)) == -1 || (sequence[1] = readInputByte(backgroundProcessList)) == -1){
+                    break;
+                }
+                if(sequence[0] != '[' && sequence[0] != 'O'){
+                    break;
+                }
+                switch(sequence[1]){
+                    case 'C':
+                        if(editor.cursor < editor.length){
+                            editor.cursor++;
+                        }
+                        break;
+                    case 'D':
+                        if(editor.cursor > 0){
+                            editor.cursor--;
+                        }
+                        break;
+                    case 'H':
+                        editor.cursor = 0;
+                        break;
+                    case 'F':
+                        editor.cursor = editor.length;
+                        break;
+                    //delete key is ESC [ 3 ~
+                    case '3':
+                        if((sequence[2] = readInputByte(backgroundProcessList)) == '~'){
+                            deleteFromLine(&editor, editor.cursor);
+                        }
+                        break;
+                }
+                break;
+            }
+            default:
+                //ignore other control characters
+                if(!iscntrl((unsigned char) key)){
+                    insertIntoLine(&editor, &key, 1);
+                }
+                break;
+        }
+        refreshLine(&editor);
+    }
+}
+
+//gets user input, stores in commandLineBuffer 
+//and chomps(deletes) trailing newline from pressing enter to input command
+//when input is a terminal, the line is read with line editing and tab completion
+//returns FALSE when there is no more input
+BOOL getUserInput(char commandLineBuffer[COMMAND_LINE_MAX_LENGTH], struct BackgroundProcessList *backgroundProcessList){
+    //clear the buffer
+    bzero(commandLineBuffer, COMMAND_LINE_MAX_LENGTH);
+    //write out prompt before waiting for input
+    fflush(stdout);
+    //use line editor if we can put the terminal into raw mode
+    if(isatty(STDIN_FILENO) && tcgetattr(STDIN_FILENO, &originalTerminalSettings) == 0){
+        struct termios rawSettings = originalTerminalSettings;
+        //read key presses one at a time without echo, and handle control-c ourselves
+        //output processing is left on so '\n' still moves to the start of the next line
+        rawSettings.c_iflag &= ~(ICRNL | IXON | BRKINT | ISTRIP | INPCK);
+        rawSettings.c_lflag &= ~(ECHO | ICANON | ISIG | IEXTEN);
+        rawSettings.c_cflag |= CS8;
+        rawSettings.c_cc[VMIN] = 1;
+        rawSettings.c_cc[VTIME] = 0;
+        if(tcsetattr(STDIN_FILENO, TCSADRAIN, &rawSettings) == 0){
+            BOOL hasInput = readLineInteractive(commandLineBuffer, backgroundProcessList);
+            //restore terminal, so commands get the settings they expect
+            tcsetattr(STDIN_FILENO, TCSADRAIN, &originalTerminalSettings);
+            return hasInput;
+        }
+    }
+    //read until newline - line is less than max, since we need to put null char at end
+    //(longer lines are split, so the rest is read as the next line)
+    int length = 0;
+    while(length < COMMAND_LINE_MAX_LENGTH - 2){
+        int nextByte = readInputByte(backgroundProcessList);
+        //end of input - return last line if it didn't end in newline
+        if(nextByte == -1){
+            return length > 0;
+        }
+        //newline is chomped
+        if(nextByte == '\n'){
+            break;
+        }
+        commandLineBuffer[length++] = nextByte;
+    }
+    return TRUE;
+}
+
+/*************************************
+* Parse user input functions
+**************************************/
+//returns 1 'true' if command matches 'cd' or 'cd <directory_name>', 
+//0 'false' otherwise
+int isCommandCD(char commandLineBuffer[COMMAND_LINE_MAX_LENGTH], int bufferLength){
+    //sanity check - command must be at least length 2
+    //to contain 'cd'
+    if(bufferLength < 2){
+        return 0;
+    }
+    //check for just plain 'cd'
+    if(strcmp(commandLineBuffer, "cd") == 0){
+        return 1;
+    }
+    //if length is less than 3 can't be 'cd <directory_name>'
+    if(bufferLength < 3){
+        return 0;
+    }
+    //check for 'cd <directory_name>' - must start with 'cd<space_character>'
+    if(commandLineBuffer[0] == 'c' && commandLineBuffer[1] == 'd' && isspace(commandLineBuffer[2])){
+        return 1;
+    }
+    //must be false if we get here
+    return 0;
+
+}
+
+//returns TRUE if command is the built in command commandName, either
+//on its own or followed by whitespace and arguments
+BOOL isBuiltinCommand(char commandLineBuffer[COMMAND_LINE_MAX_LENGTH], int bufferLength, const char *commandName){
+    int nameLength = strlen(commandName);
+    if(bufferLength < nameLength || strncmp(commandLineBuffer, commandName, nameLength) != 0){
+        return FALSE;
+    }
+    return bufferLength == nameLength || isspace(commandLineBuffer[nameLength]);
+}
+
+//copies the next whitespace separated word at *cursor into word and moves *cursor past it
+//used by built in commands to read their arguments without altering the command line
+//returns FALSE if there are no more words
+BOOL readNextWord(char **cursor, char word[COMMAND_LINE_MAX_LENGTH]){
+    while(isspace(**cursor)){
+        (*cursor)++;
+    }
+    if(**cursor == '\0'){
+        return FALSE;
+    }
+    int length = 0;
+    while(**cursor != '\0' && !isspace(**cursor) && length < COMMAND_LINE_MAX_LENGTH - 1){
+        word[length++] = **cursor;
+        (*cursor)++;
+    }
+    word[length] = '\0';
+    return TRUE;
+}
+
+//returns TRUE if commandLine is a list of commands joined by ';', '&&', '||' or '&' (see parseCommandList()),
+//for places that run a single command without going through the command list runner
+//a '&' at the end is allowed, since it only marks the command as a background command
+BOOL hasListOperator(const char *commandLine){
+    const char *cursor;
+    for(cursor = commandLine; *cursor != '\0'; ++cursor){
+        if(*cursor == ';' || (cursor[0] == '|' && cursor[1] == '|')){
+            return TRUE;
+        }
+        if(*cursor == '&'){
+            const char *rest = cursor + 1;
+            while(isspace(*rest)){
+                rest++;
+            }
+            if(*rest != '\0'){
+                return TRUE;
+            }
+        }
+    }
+    return FALSE;
+}
+
+/*************************************
+* Status functions
+**************************************/
+//prints the status code
+//returns new status code which should always be 0
+//since status command should never fail
+int printStatus(int returnStatusCode){
+    //check if last process was stopped by signal
+    if(foregroundInterrupted == TRUE){
+        printf("terminated by signal %d\n", foregroundInterruptSignal);
+    }
+    else if(returnStatusCode == LOST_PROCESS_STATUS){
+        printf("exit value unknown\n");
+    }
+    else{
+        printf("exit value %d\n", returnStatusCode);
+    }
+    return 0;
+}
+
+/*************************************
+* Command statistics functions
+**************************************/
+
+//latency histograms are log-linear, like HDR histograms: each power of two range of
+//microseconds is split into STATS_SUB_BUCKET_COUNT equal buckets, so percentiles
+//are accurate to about 6% while recording is just a shift and an increment
+#define STATS_SUB_BUCKET_BITS 4
+#define STATS_SUB_BUCKET_COUNT (1 << STATS_SUB_BUCKET_BITS)
+//largest power of two recorded - 2^40 microseconds is about 12 days
+#define STATS_MAX_EXPONENT 40
+#define STATS_BUCKET_COUNT ((STATS_MAX_EXPONENT - STATS_SUB_BUCKET_BITS + 2) * STATS_SUB_BUCKET_COUNT)
+//number of buckets in hash table of command names
+#define STATS_TABLE_SIZE 256
+
+//running totals for all the runs of one command, keyed by program name (argv[0])
+struct CommandStats{
+    char *name;
+    //number of runs that have finished
+    unsigned long callCount;
+    //runs that exited with a non-zero exit value
+    unsigned long failureCount;
+    //runs that were terminated by a signal
+    unsigned long signalCount;
+    //slowest run, in microseconds from fork() to being reaped
+    uint64_t maxMicroseconds;
+    uint32_t latencyBuckets[STATS_BUCKET_COUNT];
+    //next entry in the same hash table bucket
+    struct CommandStats *next;
+};
+
+//hash table of statistics for every command run
+//entries are never freed (resetting just zeroes them), so background processes
+//can keep pointers to their entry until they are reaped
+//global, since the statistics are kept for the whole session
+struct CommandStats *commandStatsTable[STATS_TABLE_SIZE];
+
+//returns hash of string, used to find hash table buckets
+//uses FNV-1a, see: http://www.isthe.com/chongo/tech/comp/fnv/
+uint64_t hashString(const char *string, int length){
+    uint64_t hash = 14695981039346656037ULL;
+    int i;
+    for(i = 0; i < length; ++i){
+        hash ^= (unsigned char) string[i];
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+//returns statistics for command called name, creating them if this is the first time it was run
+struct CommandStats * getCommandStats(const char *name){
+    uint64_t hash = hashString(name, strlen(name));
+    struct CommandStats **bucket = &commandStatsTable[hash % STATS_TABLE_SIZE];
+    struct CommandStats *stats;
+    for(stats = *bucket; stats != NULL; stats = stats->next){
+        if(strcmp(stats->name, name) == 0){
+            return stats;
+        }
+    }
+    stats = calloc(1, sizeof(struct CommandStats));
+    assert(stats != NULL);
+    stats->name = strdup(name);
+    assert(stats->name != NULL);
+    stats->next = *bucket;
+    *bucket = stats;
+    return stats;
+}
+
+//returns statistics for the program run by commandLineBuffer, which is its first word
+//returns NULL if there is no command
+struct CommandStats * getCommandStatsForLine(char commandLineBuffer[COMMAND_LINE_MAX_LENGTH]){
+    char programName[COMMAND_LINE_MAX_LENGTH];
+    char *cursor = commandLineBuffer;
+    if(readNextWord(&cursor, programName) == FALSE){
+        return NULL;
+    }
+    return getCommandStats(programName);
+}
+
+//returns index of histogram bucket holding microseconds
+int getLatencyBucket(uint64_t microseconds){
+    if(microseconds < STATS_SUB_BUCKET_COUNT){
+        return microseconds;
+    }
+    //position of highest set bit
+    int exponent = 63 - __builtin_clzll(microseconds);
+    if(exponent > STATS_MAX_EXPONENT){
+        return STATS_BUCKET_COUNT - 1;
+    }
+    //next STATS_SUB_BUCKET_BITS bits after the highest one pick the bucket within this power of two
+    return (exponent - STATS_SUB_BUCKET_BITS + 1) * STATS_SUB_BUCKET_COUNT + ((microseconds >> (exponent - STATS_SUB_BUCKET_BITS)) & (STATS_SUB_BUCKET_COUNT - 1));
+}
+
+//returns the value in the middle of histogram bucket, which is used as the value of everything in it
+uint64_t getLatencyBucketValue(int bucket){
+    if(bucket < STATS_SUB_BUCKET_COUNT){
+        return bucket;
+    }
+    int exponent = bucket / STATS_SUB_BUCKET_COUNT + STATS_SUB_BUCKET_BITS - 1;
+    uint64_t lowest = (uint64_t) (STATS_SUB_BUCKET_COUNT + bucket % STATS_SUB_BUCKET_COUNT) << (exponent - STATS_SUB_BUCKET_BITS);
+    uint64_t width = (uint64_t) 1 << (exponent - STATS_SUB_BUCKET_BITS);
+    return lowest + width / 2;
+}
+
+//adds a finished run of a command to its statistics
+//status is the waitpid status of the run, and start is when it was forked
+void recordCommandStats(struct CommandStats *stats, int status, const struct timespec *start){
+    if(stats == NULL){
+        return;
+    }
+    uint64_t microseconds = getElapsedMicroseconds(start);
+    stats->callCount++;
+    if(WIFSIGNALED(status)){
+        stats->signalCount++;
+    }
+    else if(WEXITSTATUS(status) != 0){
+        stats->failureCount++;
+    }
+    if(microseconds > stats->maxMicroseconds){
+        stats->maxMicroseconds = microseconds;
+    }
+    stats->latencyBuckets[getLatencyBucket(microseconds)]++;
+}
+
+//returns latency that percentile (0 to 100) of the runs of a command were at or below
+uint64_t getLatencyPercentile(struct CommandStats *stats, double percentile){
+    if(stats->callCount == 0){
+        return 0;
+    }
+    //number of runs that have to be counted to reach percentile
+    uint64_t target = (uint64_t) (percentile / 100 * stats->callCount + 0.5);
+    if(target < 1){
+        target = 1;
+    }
+    uint64_t runsCounted = 0;
+    int i;
+    for(i = 0; i < STATS_BUCKET_COUNT; ++i){
+        runsCounted += stats->latencyBuckets[i];
+        if(runsCounted >= target){
+            //bucket value can be a little larger than anything actually recorded
+            uint64_t value = getLatencyBucketValue(i);
+            return value < stats->maxMicroseconds ? value : stats->maxMicroseconds;
+        }
+    }
+    return stats->maxMicroseconds;
+}
+
+//formats microseconds in human readable units into formatted
+void formatMicroseconds(uint64_t microseconds, char formatted[32]){
+    if(microseconds < 1000){
+        sprintf(formatted, "%luus", (unsigned long) microseconds);
+    }
+    else if(microseconds < 1000000){
+        sprintf(formatted, "%.2fms", microseconds / 1000.0);
+    }
+    else{
+        sprintf(formatted, "%.2fs", microseconds / 1000000.0);
+    }
+}
+
+//prints string as a json string, escaping characters that need it
+void printJsonString(const char *string){
+    printf("\"");
+    const char *currentChar;
+    for(currentChar = string; *currentChar != '\0'; ++currentChar){
+        if(*currentChar == '"' || *currentChar == '\\'){
+            printf("\\%c", *currentChar);
+        }
+        else if(iscntrl((unsigned char) *currentChar)){
+            printf("\\u%04x", (unsigned char) *currentChar);
+        }
+        else{
+            printf("%c", *currentChar);
+        }
+    }
+    printf("\"");
+}
+
+//used with qsort to sort statistics by command name
+int compareCommandStats(const void *a, const void *b){
+    return strcmp((*(struct CommandStats * const *) a)->name, (*(struct CommandStats * const *) b)->name);
+}
+
+//prints statistics of every command that has been run, sorted by name
+//as a table, or as json if asJson is TRUE
+void printCommandStats(BOOL asJson){
+    //collect commands that have been run since the last reset
+    int statsCount = 0;
+    int i;
+    struct CommandStats *stats;
+    for(i = 0; i < STATS_TABLE_SIZE; ++i){
+        for(stats = commandStatsTable[i]; stats != NULL; stats = stats->next){
+            if(stats->callCount > 0){
+                statsCount++;
+            }
+        }
+    }
+    struct CommandStats **sortedStats = malloc(sizeof(struct CommandStats *) * (statsCount + 1));
+    assert(sortedStats != NULL);
+    int sortedIndex = 0;
+    for(i = 0; i < STATS_TABLE_SIZE; ++i){
+        for(stats = commandStatsTable[i]; stats != NULL; stats = stats->next){
+            if(stats->callCount > 0){
+                sortedStats[sortedIndex++] = stats;
+            }
+        }
+    }
+    qsort(sortedStats, statsCount, sizeof(struct CommandStats *), compareCommandStats);
+
+    if(asJson == TRUE){
+        printf("{\"commands\": [");
+        for(i = 0; i < statsCount; ++i){
+            stats = sortedStats[i];
+            printf("%s\n  {\"name\": ", i == 0 ? "" : ",");
+            printJsonString(stats->name);
+            printf(", \"calls\": %lu, \"failures\": %lu, \"signals\": %lu, \"p50_us\": %lu, \"p90_us\": %lu, \"p99_us\": %lu, \"max_us\": %lu}",
+                stats->callCount, stats->failureCount, stats->signalCount,
+                (unsigned long) getLatencyPercentile(stats, 50), (unsigned long) getLatencyPercentile(stats, 90),
+                (unsigned long) getLatencyPercentile(stats, 99), (unsigned long) stats->maxMicroseconds);
+        }
+        printf("%s]", statsCount > 0 ? "\n" : "");
+        if(journal.fileDescriptor != -1){
+            printf(", \"journal\": {\"records\": %lu, \"syncs\": %lu, \"sync_us\": %lu, \"skipped_lines\": %lu}",
+                journal.recordCount, journal.syncCount, (unsigned long) journal.syncMicroseconds, journal.skippedLineCount);
+        }
+        printf("}\n");
+    }
+    else{
+        printf("%-20s %8s %8s %8s %10s %10s %10s %10s\n", "command", "calls", "failed", "signaled", "p50", "p90", "p99", "max");
+        for(i = 0; i < statsCount; ++i){
+            stats = sortedStats[i];
+            char p50[32];
+            char p90[32];
+            char p99[32];
+            char max[32];
+            formatMicroseconds(getLatencyPercentile(stats, 50), p50);
+            formatMicroseconds(getLatencyPercentile(stats, 90), p90);
+            formatMicroseconds(getLatencyPercentile(stats, 99), p99);
+            formatMicroseconds(stats->maxMicroseconds, max);
+            printf("%-20s %8lu %8lu %8lu %10s %10s %10s %10s\n", stats->name, stats->callCount, stats->failureCount, stats->signalCount, p50, p90, p99, max);
+        }
+        //cost of journaling, when running with --journal
+        if(journal.fileDescriptor != -1){
+            char syncTime[32];
+            char averageSyncTime[32];
+            formatMicroseconds(journal.syncMicroseconds, syncTime);
+            formatMicroseconds(journal.syncCount > 0 ? journal.syncMicroseconds / journal.syncCount : 0, averageSyncTime);
+            printf("journal: %lu records in %lu syncs, %s syncing (%s per sync), %lu completed lines skipped\n",
+                journal.recordCount, journal.syncCount, syncTime, averageSyncTime, journal.skippedLineCount);
+        }
+    }
+    free(sortedStats);
+}
+
+//clears statistics of every command, and the counts of journal records and syncs
+//entries are zeroed rather than freed, since background processes may still point to them
+void resetCommandStats(){
+    int i;
+    struct CommandStats *stats;
+    for(i = 0; i < STATS_TABLE_SIZE; ++i){
+        for(stats = commandStatsTable[i]; stats != NULL; stats = stats->next){
+            stats->callCount = 0;
+            stats->failureCount = 0;
+            stats->signalCount = 0;
+            stats->maxMicroseconds = 0;
+            bzero(stats->latencyBuckets, sizeof(stats->latencyBuckets));
+        }
+    }
+    journal.recordCount = 0;
+    journal.syncCount = 0;
+    journal.syncMicroseconds = 0;
+    journal.skippedLineCount = 0;
+}
+
+//executes 'stats' command in commandLineBuffer
+//'stats' prints statistics as a table, 'stats --json' prints them as json, and 'stats reset' clears them
+//returns status code - 0 means success, 1 means arguments were invalid
+int executeStats(char commandLineBuffer[COMMAND_LINE_MAX_LENGTH]){
+    BOOL asJson = FALSE;
+    BOOL shouldReset = FALSE;
+    //skip over 'stats'
+    char *cursor = &commandLineBuffer[strlen("stats")];
+    char word[COMMAND_LINE_MAX_LENGTH];
+    while(readNextWord(&cursor, word) == TRUE){
+        if(strcmp(word, "--json") == 0){
+            asJson = TRUE;
+        }
+        else if(strcmp(word, "reset") == 0){
+            shouldReset = TRUE;
+        }
+        else{
+            printf("usage: stats [--json] [reset]\n");
+            return 1;
+        }
+    }
+    //print before resetting, so 'stats reset' shows the numbers that are thrown away
+    if(shouldReset == FALSE || asJson == TRUE){
+        printCommandStats(asJson);
+    }
+    if(shouldReset == TRUE){
+        resetCommandStats();
+    }
+    return 0;
+}
+
+/*************************************
+* 'CD' functions
+**************************************/
+//executes 'cd' command in commandLineBuffer by
+//changing current working directory to that given in the command, or the home directory
+//if none given
+//if there is an error - such as directory not readable, not existing, or a file and not a directory
+//will print error message and not change working directory
+//returns status code - 0 means success, 1 means there was an error
+int executeCD(char commandLineBuffer[COMMAND_LINE_MAX_LENGTH], int bufferLength){
+    //extract directory from command
+    //initialize variable to hold directory
+    char *directoryName;
+    //need to know if we need to free directoryName, since
+    //getting environment variable doesn't allocate space
+    int didAllocateDirectoryName = 0;
+    //if just 'cd', directoryName should be home directory
+    if(strcmp(commandLineBuffer, "cd") == 0){
+        //don't allocate memory for directoryName, since getenv returns
+        //pointer to already existing string
+        directoryName = getenv("HOME");
+        //in the case that environment variable can't be found,
+        //null is returned, so check for that, as that is an error
+        if(directoryName == NULL){
+            return 1;
+        }
+    }
+    //else all data after 'cd ' is directory name
+    else{
+        //allocate memory for directoryName
+        directoryName = malloc(sizeof(char) * COMMAND_LINE_MAX_LENGTH);
+        //check malloc succeeded
+        assert(directoryName != NULL);
+        //save that we allocated memory
+        didAllocateDirectoryName = 1;
+        //fill with null bytes
+        bzero(directoryName, COMMAND_LINE_MAX_LENGTH);
+        //based on: http://stackoverflow.com/questions/6205195/how-can-i-copy-part-of-another-string-in-c-given-a-starting-and-ending-index
+        //int startIndex = &commandLineBuffer + 2;
+        strncpy(directoryName, (char *) &commandLineBuffer[3], bufferLength - 3);
+    }
+    //change working directory - if return value is -1 there were errors, 0 means it succeeded
+    //based on: https://www.gnu.org/software/libc/manual/html_node/Working-Directory.html
+    //and http://stackoverflow.com/questions/12510874/how-can-i-check-if-a-directory-exists
+    //and http://pubs.opengroup.org/onlinepubs/009695399/functions/opendir.html
+    int changeWorkingDirectoryReturnValue = chdir(directoryName);
+    if(changeWorkingDirectoryReturnValue == 0){
+        //directory exists, and is readable and user has permissions
+        //free memory if we allocated it
+        if(didAllocateDirectoryName){
+            free(directoryName);
+        }
+        return 0;
+    }
+    //there was an error, so figure out what it was 
+    //and print out relevant error message
+    switch(errno){
+        //directoryName is a file, not a directory
+        case ENOTDIR:
+            printf("%s is not a directory\n", directoryName);
+            break;
+        //no permission
+        case EACCES:
+            printf("You do not have permission to view %s\n", directoryName);
+            break;
+        //directory name empty or directory doesn't exist
+        case ENOENT:
+            printf("%s does not exist\n", directoryName);
+            break;
+        //generic error message
+        default:
+            printf("Could not open %s\n", directoryName);
+            break;
+    }
+    //free memory if we allocated it
+    if(didAllocateDirectoryName){
+        free(directoryName);
+    }
+    //return 1 since there was an error
+    return 1;
+}
+
+/*************************************
+* Execute arbitrary command functions
+**************************************/
+
+////////////////////////////////////////
+//Parse Argument functions
+////////////////////////////////////////
+
+//parses commands and arguments in commandLineBuffer and splits into array at whitespace
+//commandArguments should be empty array where return value is stored and last item is NULL
+//allocates memory for strings in commandArguments so should be destroyed afterwards
+//commandLineBuffer is altered by strtok
+//returns length of commandArguments array
+int parseCommandArguments(char commandLineBuffer[COMMAND_LINE_MAX_LENGTH], char *commandArguments[MAX_ARGUMENT_COUNT + 1]){
+    //pointer used by strtok_r to store position in string
+    char *save;
+    //initialize variable to hold current position in array
+    int i = 0;
+    //initialize strtok with commandLineBuffer
+    char *currentWord = strtok_r(commandLineBuffer, " ", &save);
+
+    //continue until no more arguments in buffer or we have reached argument count limit
+    while( i < MAX_ARGUMENT_COUNT && currentWord != NULL){
+        //need to allocate and copy space for word or it will
+        //be cleaned up once we exit function
+        char *savedWord = malloc(strlen(currentWord) + 1);
+        //sanity check for malloc
+        assert(savedWord != NULL);
+        //copy currentWord so it can be saved
+        strcpy(savedWord, currentWord);
+
+        commandArguments[i] = savedWord;
+        i++;
+        //after the first time, call strtok with NULL
+        currentWord = strtok_r(NULL, " ", &save);
+    }
+    //make sure last item is NULL
+    commandArguments[i] = NULL;
+    return i;
+}
+
+//checks arguments for "token <filename>" and returns the string matching "<filename>"
+//also replaces "token" and "<filename>" with NULL in arguments so they will not be executed
+//returns NULL if there is no redirection
+//'>' is token for output redirection, '<' is token for input redirection
+char * parseRedirection(char *commandArguments[MAX_ARGUMENT_COUNT + 1], char *token){
+    //if last character was token the next string is the filename
+    BOOL previousArgWasToken = FALSE;
+    //iterate through arguments until we reach null, since that indicates the end of the arguments
+    int i = 0;
+    char *currentArgument;
+    while((currentArgument = commandArguments[i]) != NULL){
+        //if previous argument was token this should be the redirection filename
+        if(previousArgWasToken == TRUE){
+            //replace value in array with NULL, so won't be executed
+            commandArguments[i] = NULL;
+            return currentArgument;
+        }
+        //if token, free string and replace with null
+        //and set flag
+        else if(strcmp(currentArgument, token) == 0){
+            previousArgWasToken = TRUE;
+            //erase from arguments so it won't be executed
+            commandArguments[i] = NULL;
+            //free memory allocated for ">"
+            free(currentArgument);
+        }
+        i++;
+    }
+    //if we're here there is no output redirection (or redirection symbol but no filename), so return NULL
+    return NULL;
+}
+
+//free space allocated for arguments in commandArguments array
+void destroyCommandArguments(char *commandArguments[MAX_ARGUMENT_COUNT + 1], int argumentCount){
+    //initialize variables to hold current array index and current argument to be freed
+    int i = 0;
+    char *currentArgument;
+    //free all arguments until we reach null or we have gone past end of array
+    while(i < argumentCount && (currentArgument = commandArguments[i]) != NULL ){
+        //free memory
+        free(currentArgument);
+        i++;
+    }
+}
+
+//pid of the shell, which $$ expands to
+//set at the start of main(), so it is the same whether a command is expanded in the shell or in a forked child
+pid_t shellProcessId;
+
+//takes command in commandLineBuffer and modifies it in-place to expand
+//$$ in the command to the shell's process id
+void expandVariables(char commandLineBuffer[COMMAND_LINE_MAX_LENGTH], int bufferLength){
+    //create empty string to store commandLineBuffer with expanded pid
+    char commandLineBufferExpanded[COMMAND_LINE_MAX_LENGTH];
+    //initialize with null chars
+    bzero(commandLineBufferExpanded, COMMAND_LINE_MAX_LENGTH);
+    //initialize variables to store the index in the array for the source and destination index
+    int sourceIndex;
+    //need separate index for the destination string because as we expand $$, it will be potentially be
+    //longer than the source, and thus the indexes will be out of sync
+    int destIndex = 0;
+    //keep track if previous character was a dollar sign, because if we then see a second one we know to expand
+    BOOL previousCharWasDollarSign = FALSE;
+    //convert pid to string
+    //based on: http://stackoverflow.com/questions/15262315/how-to-convert-pid-t-to-string
+    char pidString[COMMAND_LINE_MAX_LENGTH];
+    sprintf(pidString, "%ld", (long)shellProcessId);
+    int pidStringLength = strlen(pidString);
+
+    //copy all the chars from commandLineBuffer into expanded version, while checking for $$ and expanding it to pid
+    for(sourceIndex = 0; sourceIndex < bufferLength && destIndex < COMMAND_LINE_MAX_LENGTH - 1; ++sourceIndex){
+        char currentChar = commandLineBuffer[sourceIndex];
+        //if the current character is '$' and the previous character was '$', we know we need to expand it
+        if(currentChar == '$' && previousCharWasDollarSign == TRUE){
+            //we need to erase the previous dollar sign, so back to previous index
+            destIndex--;
+            int pidStringIndex;
+            //copy pid string to expanded variables, overwriting the previous $ that we have already written
+            for(pidStringIndex = 0; pidStringIndex < pidStringLength; ++pidStringIndex){
+                char pidChar = pidString[pidStringIndex];
+                commandLineBufferExpanded[destIndex] = pidChar;
+                //increase destination index, since we added a character
+                destIndex++;
+            }
+            //reset if previous char was dollar sign, because we need to be able to expand
+            //$$$$ to pidpid
+            previousCharWasDollarSign = FALSE;
+        }
+        //no consecutive dollar sign, so no expanding variables
+        else{
+            //see if we are seeing dollar sign for the first time
+            if(currentChar == '$'){
+                previousCharWasDollarSign = TRUE;
+            }
+            //otherwise reset it
+            else{
+                previousCharWasDollarSign = FALSE;
+            }
+            //no variables to expand, so simply copy current character
+            //and increment the destination index, since we have written in it
+            commandLineBufferExpanded[destIndex] = currentChar;
+            destIndex++;
+        }
+    }
+    //overwrite commandLineBuffer with expanded version
+    //if the expanded version ends up being longer than the max length it will be truncated
+    strncpy(commandLineBuffer, commandLineBufferExpanded, COMMAND_LINE_MAX_LENGTH);
+}
+
+
+/////////////////////////////////////////////////////
+// Parse for command for background process and input
+//output redirection
+/////////////////////////////////////////////////////
+
+//determines if command ends with '&' so that command should run in background
+//also erases ending '&' if there is one with null chars so it will not be executed
+BOOL shouldExecuteInBackground(char commandLineBuffer[COMMAND_LINE_MAX_LENGTH], int bufferLength){
+    int i;
+    //start at end of command, ignoring whitespace to find first non-whitespace character
+    //if that character is '&' delete it and return true, otherwise return false
+    for (i = bufferLength -1; i >= 0; --i){
+        //ignore trailing whitespace
+        if(isspace(commandLineBuffer[i])){
+            continue;
+        }
+        //'&' found at end of the string
+        if(commandLineBuffer[i] == '&'){
+            //erase character from string
+            commandLineBuffer[i] = '\0';
+            return TRUE;
+        }
+        //first non-whitespace character was found and it is not '&'
+        else{
+            break;
+        }
+    }
+    //'&' not found
+    return FALSE;
+}
+
+
+
+/*************************************
+* 'cat' and 'cp' functions
+**************************************/
+
+//ways copyFileData() can copy data, from fastest to slowest
+#define FILE_COPY_RANGE 0
+#define FILE_COPY_SENDFILE 1
+#define FILE_COPY_SPLICE 2
+#define FILE_COPY_READ_WRITE 3
+//most bytes copied at a time, so control-c is noticed quickly
+#define FILE_COPY_CHUNK_SIZE (8 * 1024 * 1024)
+
+//returns TRUE if commandArguments is a 'cat' or 'cp' command the shell can run itself,
+//which saves starting a new program
+//commands with options are left to the real programs, since only the plain forms are supported
+BOOL isFileCommand(char *commandArguments[MAX_ARGUMENT_COUNT + 1]){
+    if(commandArguments[0] == NULL || (strcmp(commandArguments[0], "cat") != 0 && strcmp(commandArguments[0], "cp") != 0)){
+        return FALSE;
+    }
+    int i;
+    for(i = 1; commandArguments[i] != NULL; ++i){
+        //'-' on its own is standard input, not an option
+        if(commandArguments[i][0] == '-' && commandArguments[i][1] != '\0'){
+            return FALSE;
+        }
+    }
+    return TRUE;
+}
+
+//returns TRUE if errorCode means a way of copying isn't supported for these files, so the next one should be tried
+BOOL isCopyMethodUnsupported(int errorCode){
+    return errorCode == EINVAL || errorCode == ENOSYS || errorCode == EXDEV || errorCode == EOPNOTSUPP || errorCode == EBADF;
+}
+
+//copies everything from inputFileDescriptor to outputFileDescriptor, starting at their current positions
+//data is kept out of user space wherever the kernel allows it: a whole file copied into an empty one is cloned (reflinked)
+//if the filesystem supports it, otherwise copy_file_range() is used, then sendfile() or splice(),
+//and read() and write() only if none of those work for these files
+//stops early if control-c is pressed
+//when run by the shell itself, backgroundProcessList is given, and the shell's other work (deadlines, captured output,
+//queued commands) is handled between chunks - otherwise it is NULL
+//returns 0 if successful, otherwise the errno of what went wrong
+int copyFileData(int inputFileDescriptor, int outputFileDescriptor, struct BackgroundProcessList *backgroundProcessList){
+    struct stat inputInfo;
+    struct stat outputInfo;
+    if(fstat(inputFileDescriptor, &inputInfo) == -1 || fstat(outputFileDescriptor, &outputInfo) == -1){
+        return errno;
+    }
+    BOOL isInputRegular = S_ISREG(inputInfo.st_mode);
+    //cloned file shares its blocks with the original until either is changed
+    if(isInputRegular && S_ISREG(outputInfo.st_mode) && outputInfo.st_size == 0 && lseek(inputFileDescriptor, 0, SEEK_CUR) == 0 && lseek(outputFileDescriptor, 0, SEEK_CUR) == 0 && ioctl(outputFileDescriptor, FICLONE, inputFileDescriptor) == 0){
+        //leave both at the end, as if the data had been copied
+        lseek(inputFileDescriptor, 0, SEEK_END);
+        lseek(outputFileDescriptor, 0, SEEK_END);
+        return 0;
+    }
+    //copy_file_range() needs two regular files, and sendfile() a regular input file
+    //splice() needs one of the files to be a pipe
+    int method = FILE_COPY_RANGE;
+    if(!S_ISREG(outputInfo.st_mode)){
+        method = FILE_COPY_SENDFILE;
+    }
+    if(!isInputRegular){
+        method = S_ISFIFO(inputInfo.st_mode) || S_ISFIFO(outputInfo.st_mode) ? FILE_COPY_SPLICE : FILE_COPY_READ_WRITE;
+    }
+    //files in /proc and /sys claim to be empty, and only give their contents to read()
+    if(isInputRegular && inputInfo.st_size == 0){
+        method = FILE_COPY_READ_WRITE;
+    }
+    //only allocated if read() and write() have to be used
+    char *buffer = NULL;
+    int errorCode = 0;
+    while(!interruptReceived){
+        ssize_t copiedCount;
+        if(method == FILE_COPY_RANGE){
+            copiedCount = copy_file_range(inputFileDescriptor, NULL, outputFileDescriptor, NULL, FILE_COPY_CHUNK_SIZE, 0);
+        }
+        else if(method == FILE_COPY_SENDFILE){
+            copiedCount = sendfile(outputFileDescriptor, inputFileDescriptor, NULL, FILE_COPY_CHUNK_SIZE);
+        }
+        else if(method == FILE_COPY_SPLICE){
+            copiedCount = splice(inputFileDescriptor, NULL, outputFileDescriptor, NULL, FILE_COPY_CHUNK_SIZE, SPLICE_F_MOVE);
+        }
+        else{
+            if(buffer == NULL){
+                buffer = malloc(INPUT_BUFFER_SIZE * 16);
+                assert(buffer != NULL);
+            }
+            copiedCount = read(inputFileDescriptor, buffer, INPUT_BUFFER_SIZE * 16);
+            ssize_t writtenCount = 0;
+            while(copiedCount > 0 && writtenCount < copiedCount){
+                ssize_t result = write(outputFileDescriptor, buffer + writtenCount, copiedCount - writtenCount);
+                if(result == -1 && errno != EINTR){
+                    copiedCount = -1;
+                    break;
+                }
+                writtenCount += result > 0 ? result : 0;
+            }
+        }
+        if(copiedCount == 0){
+            break;
+        }
+        if(copiedCount == -1){
+            if(errno == EINTR){
+                continue;
+            }
+            if(method != FILE_COPY_READ_WRITE && isCopyMethodUnsupported(errno)){
+                method++;
+                continue;
+            }
+            errorCode = errno;
+            break;
+        }
+        if(backgroundProcessList != NULL){
+            pollShellEvents(-1, -1, backgroundProcessList, 0);
+        }
+    }
+    free(buffer);
+    if(errorCode == 0 && interruptReceived){
+        errorCode = EINTR;
+    }
+    return errorCode;
+}
+
+//copies each file named in commandArguments (or input, if there are none) to output
+//'-' is also input, like the real 'cat'
+//backgroundProcessList is NULL unless it is run by the shell itself, see copyFileData()
+//returns 0 if successful, 1 otherwise
+int runCat(char *commandArguments[MAX_ARGUMENT_COUNT + 1], int inputFileDescriptor, int outputFileDescriptor, struct BackgroundProcessList *backgroundProcessList){
+    if(commandArguments[1] == NULL){
+        int errorCode = copyFileData(inputFileDescriptor, outputFileDescriptor, backgroundProcessList);
+        if(errorCode != 0){
+            fprintf(stderr, "cat: %s\n", strerror(errorCode));
+        }
+        return errorCode != 0;
+    }
+    int status = 0;
+    int i;
+    for(i = 1; commandArguments[i] != NULL && !interruptReceived; ++i){
+        BOOL isInput = strcmp(commandArguments[i], "-") == 0;
+        int fileDescriptor = isInput ? inputFileDescriptor : open(commandArguments[i], O_RDONLY | O_CLOEXEC);
+        int errorCode = fileDescriptor == -1 ? errno : copyFileData(fileDescriptor, outputFileDescriptor, backgroundProcessList);
+        if(errorCode != 0){
+            fprintf(stderr, "cat: %s: %s\n", commandArguments[i], strerror(errorCode));
+            status = 1;
+        }
+        if(fileDescriptor != -1 && !isInput){
+            close(fileDescriptor);
+        }
+    }
+    return status;
+}
+
+//copies file at sourcePath to destinationPath, or into it if isDirectory is TRUE
+//new files get the same permissions as the source file
+//backgroundProcessList is NULL unless it is run by the shell itself, see copyFileData()
+//returns 0 if successful, 1 otherwise
+int copyFile(const char *sourcePath, const char *destinationPath, BOOL isDirectory, struct BackgroundProcessList *backgroundProcessList){
+    char path[PATH_MAX];
+    if(isDirectory == TRUE){
+        const char *slash = strrchr(sourcePath, '/');
+        snprintf(path, sizeof(path), "%s/%s", destinationPath, slash == NULL ? sourcePath : slash + 1);
+        destinationPath = path;
+    }
+    int inputFileDescriptor = open(sourcePath, O_RDONLY | O_CLOEXEC);
+    struct stat sourceInfo;
+    if(inputFileDescriptor == -1 || fstat(inputFileDescriptor, &sourceInfo) == -1){
+        fprintf(stderr, "cp: cannot stat '%s': %s\n", sourcePath, strerror(errno));
+        if(inputFileDescriptor != -1){
+            close(inputFileDescriptor);
+        }
+        return 1;
+    }
+    if(S_ISDIR(sourceInfo.st_mode)){
+        fprintf(stderr, "cp: -r not specified; omitting directory '%s'\n", sourcePath);
+        close(inputFileDescriptor);
+        return 1;
+    }
+    //opening the destination would truncate the source if they are the same file
+    struct stat destinationInfo;
+    if(stat(destinationPath, &destinationInfo) == 0 && destinationInfo.st_dev == sourceInfo.st_dev && destinationInfo.st_ino == sourceInfo.st_ino){
+        fprintf(stderr, "cp: '%s' and '%s' are the same file\n", sourcePath, destinationPath);
+        close(inputFileDescriptor);
+        return 1;
+    }
+    int outputFileDescriptor = open(destinationPath, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, sourceInfo.st_mode & 0777);
+    if(outputFileDescriptor == -1){
+        fprintf(stderr, "cp: cannot create regular file '%s': %s\n", destinationPath, strerror(errno));
+        close(inputFileDescriptor);
+        return 1;
+    }
+    int errorCode = copyFileData(inputFileDescriptor, outputFileDescriptor, backgroundProcessList);
+    close(inputFileDescriptor);
+    //errors writing to some filesystems only show up when the file is closed
+    if(close(outputFileDescriptor) == -1 && errorCode == 0){
+        errorCode = errno;
+    }
+    if(errorCode != 0){
+        fprintf(stderr, "cp: error copying '%s' to '%s': %s\n", sourcePath, destinationPath, strerror(errorCode));
+        return 1;
+    }
+    return 0;
+}
+
+//copies files in commandArguments, either 'cp SOURCE DESTINATION' or 'cp SOURCE... DIRECTORY'
+//backgroundProcessList is NULL unless it is run by the shell itself, see copyFileData()
+//returns 0 if successful, 1 otherwise
+int runCp(char *commandArguments[MAX_ARGUMENT_COUNT + 1], struct BackgroundProcessList *backgroundProcessList){
+    int argumentCount = 0;
+    while(commandArguments[argumentCount] != NULL){
+        argumentCount++;
+    }
+    if(argumentCount < 3){
+        fprintf(stderr, "cp: missing file operand\n");
+        return 1;
+    }
+    const char *destinationPath = commandArguments[argumentCount - 1];
+    struct stat destinationInfo;
+    BOOL isDirectory = stat(destinationPath, &destinationInfo) == 0 && S_ISDIR(destinationInfo.st_mode);
+    if(argumentCount > 3 && isDirectory == FALSE){
+        fprintf(stderr, "cp: target '%s' is not a directory\n", destinationPath);
+        return 1;
+    }
+    int status = 0;
+    int i;
+    for(i = 1; i < argumentCount - 1 && !interruptReceived; ++i){
+        status |= copyFile(commandArguments[i], destinationPath, isDirectory, backgroundProcessList);
+    }
+    return status;
+}
+
+//runs 'cat' or 'cp' command in commandArguments, which has been checked with isFileCommand()
+//redirection has already been removed from commandArguments, and 'cat' reads from inputFileDescriptor and writes to outputFileDescriptor
+//errors go to standard error, so they don't end up in the output
+//backgroundProcessList is NULL unless it is run by the shell itself, see copyFileData()
+//returns 0 if successful, 1 otherwise
+int runFileCommand(char *commandArguments[MAX_ARGUMENT_COUNT + 1], int inputFileDescriptor, int outputFileDescriptor, struct BackgroundProcessList *backgroundProcessList){
+    interruptReceived = 0;
+    int status;
+    if(strcmp(commandArguments[0], "cat") == 0){
+        status = runCat(commandArguments, inputFileDescriptor, outputFileDescriptor, backgroundProcessList);
+    }
+    else{
+        status = runCp(commandArguments, backgroundProcessList);
+    }
+    if(interruptReceived){
+        printf("\n");
+        status = 1;
+    }
+    return status;
+}
+
+//returns TRUE if path is a regular file or directory, or doesn't exist, so opening and copying it can't block
+//(copying a missing file just fails)
+BOOL isPathNonBlocking(const char *path){
+    struct stat info;
+    return stat(path, &info) == -1 || S_ISREG(info.st_mode) || S_ISDIR(info.st_mode);
+}
+
+//returns TRUE if the file command in commandArguments could block reading or writing a terminal, pipe or fifo,
+//where the shell couldn't handle its other work between chunks, so it is run in a child process instead
+//inputFileName and outputFileName are its redirection files, or NULL for the shell's standard input and output
+BOOL canFileCommandBlock(char *commandArguments[MAX_ARGUMENT_COUNT + 1], const char *inputFileName, const char *outputFileName){
+    //'cat' reads standard input if it has no files, or for '-'
+    BOOL isCat = strcmp(commandArguments[0], "cat") == 0;
+    BOOL readsInput = isCat && commandArguments[1] == NULL;
+    int i;
+    for(i = 1; commandArguments[i] != NULL; ++i){
+        if(isCat && strcmp(commandArguments[i], "-") == 0){
+            readsInput = TRUE;
+        }
+        else if(isPathNonBlocking(commandArguments[i]) == FALSE){
+            return TRUE;
+        }
+    }
+    struct stat info;
+    if(readsInput && (inputFileName != NULL ? !isPathNonBlocking(inputFileName) : (fstat(STDIN_FILENO, &info) == -1 || !S_ISREG(info.st_mode)))){
+        return TRUE;
+    }
+    //output can also go to the terminal, which doesn't hold up writes
+    if(outputFileName != NULL){
+        return !isPathNonBlocking(outputFileName);
+    }
+    return fstat(STDOUT_FILENO, &info) == -1 || !(S_ISREG(info.st_mode) || S_ISCHR(info.st_mode));
+}
+
+//returns TRUE if commandLineBuffer is a foreground 'cat' or 'cp' command the shell can run itself
+//commands reading or writing a terminal, pipe or fifo (apart from writing the terminal) are run in a child process,
+//so the shell is never stuck waiting on them
+//background ones are run in a child process, like any other command, which then runs them without starting a new program
+BOOL isFileCommandLine(char commandLineBuffer[COMMAND_LINE_MAX_LENGTH], int bufferLength){
+    if(!isBuiltinCommand(commandLineBuffer, bufferLength, "cat") && !isBuiltinCommand(commandLineBuffer, bufferLength, "cp")){
+        return FALSE;
+    }
+    //parsing changes the command line, so check a copy
+    char lineCopy[COMMAND_LINE_MAX_LENGTH];
+    strcpy(lineCopy, commandLineBuffer);
+    if(shouldExecuteInBackground(lineCopy, bufferLength) == TRUE){
+        return FALSE;
+    }
+    expandVariables(lineCopy, bufferLength);
+    char *commandArguments[MAX_ARGUMENT_COUNT + 1];
+    int argumentCount = parseCommandArguments(lineCopy, commandArguments);
+    char *outputFileName = parseRedirection(commandArguments, ">");
+    char *inputFileName = parseRedirection(commandArguments, "<");
+    BOOL isFile = isFileCommand(commandArguments) && !canFileCommandBlock(commandArguments, inputFileName, outputFileName);
+    free(outputFileName);
+    free(inputFileName);
+    //redirection leaves gaps in commandArguments, so free everything left instead of stopping at the first NULL
+    int i;
+    for(i = 0; i < argumentCount; ++i){
+        free(commandArguments[i]);
+    }
+    return isFile;
+}
+
+//executes foreground 'cat' or 'cp' command in commandLineBuffer in the shell process, with '<' and '>' redirection
+//returns 0 if successful, 1 otherwise
+int executeFileCommand(char commandLineBuffer[COMMAND_LINE_MAX_LENGTH], int bufferLength, struct BackgroundProcessList *backgroundProcessList){
+    struct CommandStats *commandStats = getCommandStatsForLine(commandLineBuffer);
+    struct timespec startTime;
+    getMonotonicTime(&startTime);
+    expandVariables(commandLineBuffer, bufferLength);
+    char *commandArguments[MAX_ARGUMENT_COUNT + 1];
+    int argumentCount = parseCommandArguments(commandLineBuffer, commandArguments);
+    //same order as the child process uses, so the same lines work the same way
+    char *outputFileName = parseRedirection(commandArguments, ">");
+    char *inputFileName = parseRedirection(commandArguments, "<");
+    int status = 0;
+    int inputFileDescriptor = STDIN_FILENO;
+    int outputFileDescriptor = STDOUT_FILENO;
+    if(inputFileName != NULL && (inputFileDescriptor = open(inputFileName, O_RDONLY | O_CLOEXEC)) == -1){
+        printf("cannot open %s for input\n", inputFileName);
+        status = 1;
+    }
+    if(status == 0 && outputFileName != NULL && (outputFileDescriptor = open(outputFileName, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644)) == -1){
+        printf("cannot open %s for output\n", outputFileName);
+        status = 1;
+    }
+    if(status == 0){
+        //output is written straight to the file descriptor, so anything already printed has to go first
+        fflush(stdout);
+        status = runFileCommand(commandArguments, inputFileDescriptor, outputFileDescriptor, backgroundProcessList);
+    }
+    if(inputFileName != NULL){
+        if(inputFileDescriptor != -1){
+            close(inputFileDescriptor);
+        }
+        free(inputFileName);
+    }
+    if(outputFileName != NULL){
+        if(outputFileDescriptor != -1){
+            close(outputFileDescriptor);
+        }
+        free(outputFileName);
+    }
+    destroyCommandArguments(commandArguments, argumentCount);
+    recordCommandStats(commandStats, status << 8, &startTime);
+    return status;
+}
+
+
+///////////////////////////////////////////////////
+// Child and parent process functions
+//////////////////////////////////////////////////
+
+//used in child process to redirect output
+//captureFileDescriptor is the pipe output and errors are captured in, or -1 if they aren't being captured
+void redirectOutput(char *commandArguments[MAX_ARGUMENT_COUNT + 1], BOOL isBackgroundCommand, int captureFileDescriptor){
+    //get output redirection if there is any
+    char *outputFileName = parseRedirection(commandArguments, ">");
+    //need to keep track if outputFileName is allocated, so we know if we have to free it
+    //won't be allocated if we manually set to /dev/null
+    BOOL isOutputFileNameAllocated = TRUE;
+    //background commands with no output redirection get sent to /dev/null, unless their output is being captured
+    //based on: http://stackoverflow.com/questions/14846768/in-c-how-do-i-redirect-stdout-fileno-to-dev-null-using-dup2-and-then-redirect
+    if(outputFileName == NULL && isBackgroundCommand == TRUE && captureFileDescriptor == -1){
+        outputFileName = "/dev/null";
+        //set flag to false, so we don't try to free this later
+        isOutputFileNameAllocated = FALSE;
+    }
+    
+    //check for output redirection
+    if(outputFileName != NULL){
+        //based on Lecture 12 slides
+        //attempt to redirect standard output to filename
+        int fileDescriptor = open(outputFileName, O_WRONLY|O_CREAT|O_TRUNC, 0644);
+        //check that we were able to open the file
+        //-1 means there was an error trying to do this
+        if(fileDescriptor == -1){
+            printf("cannot open %s for output\n", outputFileName);
+            exit(1);
+        }
+        //redirect standard output '1' to the file we just opened
+        fileDescriptor = dup2(fileDescriptor, 1);
+        //check again for errors
+        if(fileDescriptor == -1){
+            printf("error redirecting standard output to %s\n", outputFileName);
+            exit(1);
+        }
+    }
+    //captured commands write errors, and output that isn't redirected, to the capture pipe
+    else if(captureFileDescriptor != -1){
+        dup2(captureFileDescriptor, 1);
+    }
+    if(captureFileDescriptor != -1){
+        dup2(captureFileDescriptor, 2);
+    }
+    //free outputFileName, if it was allocated
+    //need to check if null and allocated because if we manually set it to "/dev/null"
+    //it won't be allocated, or if no redirection was given it won't be allocated
+    //since we don't need it anymore
+    if(outputFileName != NULL && isOutputFileNameAllocated == TRUE){
+        free(outputFileName);
+    }
+}
+
+//used in child process to redirect standard input
+void redirectInput(char *commandArguments[MAX_ARGUMENT_COUNT + 1], BOOL isBackgroundCommand){
+    //get input redirection if there is any
+    char *inputFileName = parseRedirection(commandArguments, "<");
+    //need to keep track if inputFileName is allocated, so we know if we have to free it
+    //won't be allocated if we manually set to /dev/null
+    BOOL isInputFileNameAllocated = TRUE;
+    //background commands with no input redirection get sent to /dev/null
+    //based on: http://stackoverflow.com/questions/14846768/in-c-how-do-i-redirect-stdout-fileno-to-dev-null-using-dup2-and-then-redirect
+    if(inputFileName == NULL && isBackgroundCommand == TRUE){
+        inputFileName = "/dev/null";
+        //set flag to false, so we don't try to free this later
+        isInputFileNameAllocated = FALSE;
+    }
+    
+    //check for input redirection
+    if(inputFileName != NULL){
+        //based on Lecture 12 slides
+        //attempt to redirect standard input to filename
+        int fileDescriptor = open(inputFileName, O_RDONLY);
+        //check that we were able to open the file
+        //-1 means there was an error trying to do this
+        if(fileDescriptor == -1){
+            printf("cannot open %s for input\n", inputFileName);
+            exit(1);
+        }
+        //redirect standard input '0' to the file we just opened
+        fileDescriptor = dup2(fileDescriptor, 0);
+        //check again for errors
+        if(fileDescriptor == -1){
+            printf("error redirecting standard input to %s\n", inputFileName);
+            exit(1);
+        }
+    }
+    //free inputFileName, if it was allocated
+    //need to check if null and allocated because if we manually set it to "/dev/null"
+    //it won't be allocated, or if no redirection was given it won't be allocated
+    //since we don't need it anymore
+    if(inputFileName != NULL && isInputFileNameAllocated == TRUE){
+        free(inputFileName);
+    }
+}
+
+//prints error status if command fails, and is not a background command
+void printExecutionError(int errorCode, char *commandName, BOOL isBackgroundCommand){
+    //don't printout errors for background commands
+    if(isBackgroundCommand == TRUE){
+        return;
+    }
+    //print error based on errno
+    //based on: https://linux.die.net/man/2/execve
+    switch(errorCode){
+        //permissions error for command
+        case EACCES:
+            printf("%s: execute permission denied\n", commandName);
+            break;
+        //file doesn't exist
+        case ENOENT:
+            printf("%s: no such file or directory\n", commandName);
+            break;
+        //problem with the executable file
+        case ENOEXEC:
+            printf("%s: could not be executed\n", commandName);
+            break;
+        //unspecified error
+        default:
+            printf("There was an error with trying to run %s\n", commandName);
+            break;
+    }
+
+}
+
+//returns TRUE if standard input is a terminal that this process's group is in the foreground of
+BOOL ownsTerminal(){
+    return isatty(STDIN_FILENO) && tcgetpgrp(STDIN_FILENO) == getpgrp();
+}
+
+//makes processGroup the foreground process group of the terminal
+//SIGTTOU is blocked, since it is sent when a background process group does this
+void setTerminalProcessGroup(pid_t processGroup){
+    sigset_t ttouMask;
+    sigset_t previousMask;
+    sigemptyset(&ttouMask);
+    sigaddset(&ttouMask, SIGTTOU);
+    sigprocmask(SIG_BLOCK, &ttouMask, &previousMask);
+    tcsetpgrp(STDIN_FILENO, processGroup);
+    sigprocmask(SIG_SETMASK, &previousMask, NULL);
+}
+
+//used in child process to put itself in its own process group, so the whole job
+//can be signalled when its deadline expires
+//foreground commands also take the terminal, so they can still read from it and get control-c
+void startProcessGroup(BOOL isBackgroundCommand){
+    BOOL shouldTakeTerminal = isBackgroundCommand == FALSE && ownsTerminal();
+    setpgid(0, 0);
+    if(shouldTakeTerminal){
+        setTerminalProcessGroup(getpid());
+    }
+}
+
+//Executes parses command in commandLineBuffer and executes in foreground for child process
+//isProcessGroup is TRUE if command should run in its own process group
+//captureFileDescriptor is the pipe to capture output in, or -1
+void childProcessExecuteCommand(char commandLineBuffer[COMMAND_LINE_MAX_LENGTH], int bufferLength, BOOL isBackgroundCommand, BOOL isProcessGroup, int captureFileDescriptor){
+    if(isProcessGroup == TRUE){
+        startProcessGroup(isBackgroundCommand);
+    }
+    //expand all '$$'' to the shell's pid in commandLineBuffec
+    expandVariables(commandLineBuffer, bufferLength);
+
+    //initialize variable to store commands in commandLineBuffer parsed into array
+    //need space for 1 more than max arguments because we need to store NULL at the end
+    char *commandArguments[MAX_ARGUMENT_COUNT + 1];
+    int argumentCount = parseCommandArguments(commandLineBuffer, commandArguments);
+    //only run command if there is a command to be run
+    if(argumentCount < 1){
+        //no commands (commandLineBuffer was empty of just whitespace), so exit early
+        exit(0);
+    }
+    //save standard output, since we will need to restore it later if there is an error
+    //with a command that redirects output
+    //based on: http://stackoverflow.com/questions/11042218/c-restore-stdout-to-terminal
+    int standardOutputFileDescriptor = dup(1);
+    //redirect standard output as necessary
+    redirectOutput(commandArguments, isBackgroundCommand, captureFileDescriptor);
+    //redirect standard input as necessary
+    redirectInput(commandArguments, isBackgroundCommand);
+
+    //'cat' and 'cp' are run in this process, instead of starting a new program
+    if(isFileCommand(commandArguments) == TRUE){
+        exit(runFileCommand(commandArguments, STDIN_FILENO, STDOUT_FILENO, NULL));
+    }
+    //first item is commandArguments is program name, and we need to pass it again in the arguments
+    int status = execvp(commandArguments[0], commandArguments);
+    //check for error and normalize status to be either 1 for error
+    //or 0 for finished successfully
+    if(status == -1){
+        status = 1;
+        //restore standard output, so we can print error message
+        dup2(standardOutputFileDescriptor, 1);
+        //error status stored in errno, so printout message based on this if not background command
+        //(we have already checked that commandArguments has at least length one, so no need to check first)
+        printExecutionError(errno, commandArguments[0], isBackgroundCommand);
+    }
+    else{
+        status = 0;
+    }
+    //free memory allocated for commandArguments
+    destroyCommandArguments(commandArguments, argumentCount);
+    //close process after exec completes
+    exit(status);
+}
+
+//waits for foreground process to finish, storing its waitpid status in status
+//if deadline is not NULL, the process group is signalled when the deadline expires, and
+//then killed after deadline->killAfter if that is set
+//background deadlines are still enforced while waiting
+void waitForForegroundProcess(pid_t childProcessId, const struct CommandDeadline *deadline, struct BackgroundProcessList *backgroundProcessList, int *status){
+    int deadlineTimer = -1;
+    if(deadline != NULL){
+        deadlineTimer = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+        struct timespec expiresAt;
+        getMonotonicTime(&expiresAt);
+        addTimespec(&expiresAt, &deadline->duration, &expiresAt);
+        armTimer(deadlineTimer, &expiresAt);
+    }
+    //signal last sent because the deadline expired, 0 if none has been sent
+    int deadlineSignal = 0;
+    while(reapChild(childProcessId, status, NULL) == FALSE){
+        int events = waitForShellEvent(-1, deadlineTimer, backgroundProcessList);
+        if((events & SHELL_EVENT_TIMER) == 0){
+            continue;
+        }
+        //deadline signal was already sent, so kill-after time is up
+        if(deadlineSignal != 0){
+            deadlineSignal = SIGKILL;
+            signalJob(childProcessId, TRUE, SIGKILL);
+            continue;
+        }
+        deadlineSignal = deadline->signalNumber;
+        signalJob(childProcessId, TRUE, deadlineSignal);
+        if(!isTimespecZero(&deadline->killAfter)){
+            struct timespec expiresAt;
+            getMonotonicTime(&expiresAt);
+            addTimespec(&expiresAt, &deadline->killAfter, &expiresAt);
+            armTimer(deadlineTimer, &expiresAt);
+        }
+    }
+    if(deadlineTimer != -1){
+        close(deadlineTimer);
+    }
+    //report timeout the same way as an interrupt, unless control-c already ended it
+    if(deadlineSignal != 0 && foregroundInterrupted == FALSE){
+        foregroundInterrupted = TRUE;
+        foregroundInterruptSignal = deadlineSignal;
+    }
+    //commands with deadlines have the terminal, so control-c goes straight to them instead of the interrupt handler
+    //so record signal deaths here instead
+    else if(deadline != NULL && foregroundInterrupted == FALSE && WIFSIGNALED(*status)){
+        foregroundInterrupted = TRUE;
+        foregroundInterruptSignal = WTERMSIG(*status);
+    }
+}
+
+//action that parent takes while child process is executing command
+//involves either waiting for child process to finish executing in the foreground, or 
+//adding background process to list of background processes if it is to execute in background
+//returns status code from child in foreground after finishes executing, or 0 if child is started in background
+//childProcessId is child process id from fork()
+//deadline is NULL if the command has no deadline, in which case background commands use the default deadline if there is one
+//commandStats are the statistics the run is added to when it finishes, and startTime is when it was forked
+int parentProcessExecuteCommand(pid_t childProcessId, struct BackgroundProcessList *backgroundProcessList, BOOL isBackgroundCommand, const struct CommandDeadline *deadline, struct CommandStats *commandStats, const struct timespec *startTime){
+    //commands with deadlines have their own process group
+    //set it here too, so it exists before we try to signal it, no matter which process runs first
+    if(deadline != NULL){
+        setpgid(childProcessId, childProcessId);
+    }
+    //run command in foreground, so wait for it to finish
+    if(isBackgroundCommand == FALSE){ 
+        //create variable to store return value from child process
+        int status = 0;
+        //set global foregroundPid so interrupt (control-c) will end it
+        foregroundPid = childProcessId;
+        foregroundIsProcessGroup = deadline != NULL;
+        //hand over the terminal to the command's process group, and take it back afterwards
+        BOOL shouldReclaimTerminal = deadline != NULL && ownsTerminal();
+        if(shouldReclaimTerminal){
+            setTerminalProcessGroup(childProcessId);
+        }
+        waitForForegroundProcess(childProcessId, deadline, backgroundProcessList, &status);
+        recordCommandStats(commandStats, status, startTime);
+        if(shouldReclaimTerminal){
+            setTerminalProcessGroup(getpgrp());
+        }
+        //clear foregroundPid, since the process has finished
+        //foregroundPid = -1;
+        //if there was an error calling waitpid
+        //return value will be -1, however this will also happen if foreground process is interrupted,
+        //so there is no need to check this, as we will just get false positives
+
+
+        //check if process interrupted
+        //if so, status is meaningless, since signal number will be used in status
+        //have to print here, since we can't print in signal handler due to printf not being re-entrant
+        if(foregroundInterrupted == TRUE){
+            //0 is meaningless, since signal number will be used
+            printStatus(0);
+        }
+        //examine status - 0 means success, other values mean there was an error or 
+        //process was interrupted
+        //so normalize it for return value, keeping a lost status so printStatus() can say it's unknown
+        else if(status != 0 && status != LOST_PROCESS_STATUS){
+            status = 1;
+        }
+        return status;
+    }
+    //command is background process
+    //so just add to background processes and return immediately
+    else{
+        //print pid of child process
+        //http://stackoverflow.com/questions/20533606/what-is-the-correct-printf-specifier-for-printing-pid-t
+        //commands started from the admission queue are printed before the next prompt instead, so they don't interrupt what is being typed
+        if(admissionController.isStartingQueued == FALSE){
+            printf("background pid is %ld\n", (long) childProcessId);
+        }
+        struct BackgroundProcessNode *node = addToBackgroundProcessList(childProcessId, backgroundProcessList);
+        node->isAnnouncePending = admissionController.isStartingQueued;
+        node->commandStats = commandStats;
+        node->startTime = *startTime;
+        node->journalLine = holdJournalLine();
+        if(deadline != NULL){
+            node->isProcessGroup = TRUE;
+            setBackgroundProcessDeadline(node, deadline, backgroundProcessList);
+        }
+        return 0;
+    }
+}
+
+
+////////////////////////////////////////
+// Fork server functions
+////////////////////////////////////////
+
+//runs the command in a fork server request in a new process, set up like childProcessExecuteCommand() does
+//message holds messageLength bytes followed by a null char, and fileDescriptors are the command's standard input, output and error
+//replies to the shell with the pid of the new process - its status is sent later, once it is reaped
+void startForkServerCommand(int socket, char *message, ssize_t messageLength, int fileDescriptors[3]){
+    struct ForkServerRequest *request = (struct ForkServerRequest *) message;
+    struct ForkServerResponse response;
+    bzero(&response, sizeof(response));
+    response.type = FORK_SERVER_STARTED;
+    response.requestId = request->requestId;
+    response.processId = -1;
+    //split strings after the header back into working directory, arguments and environment
+    //message is null terminated, so the last string can't run past the end of it
+    char *commandArguments[MAX_ARGUMENT_COUNT + 1];
+    char **environment = malloc(sizeof(char *) * (request->environmentCount + 1));
+    assert(environment != NULL);
+    char *messageEnd = message + messageLength;
+    char *position = message + sizeof(struct ForkServerRequest);
+    char *workingDirectory = position;
+    position += strlen(position) + 1;
+    uint32_t i;
+    for(i = 0; i < request->argumentCount && i < MAX_ARGUMENT_COUNT && position < messageEnd; ++i){
+        commandArguments[i] = position;
+        position += strlen(position) + 1;
+    }
+    commandArguments[i] = NULL;
+    BOOL isRequestValid = i == request->argumentCount && i > 0;
+    for(i = 0; i < request->environmentCount && position < messageEnd; ++i){
+        environment[i] = position;
+        position += strlen(position) + 1;
+    }
+    environment[i] = NULL;
+    if(isRequestValid == FALSE || i != request->environmentCount){
+        response.errorCode = EINVAL;
+    }
+    else{
+        response.processId = fork();
+        //new process for command
+        if(response.processId == 0){
+            //undo the fork server's signal handling, so the command starts the same as one forked by the shell
+            signal(SIGINT, SIG_DFL);
+            signal(SIGCHLD, SIG_DFL);
+            //save standard output, which is the shell's, so errors can be printed there after it is redirected
+            int standardOutputFileDescriptor = dup(1);
+            if(chdir(workingDirectory) == -1){
+                printf("cannot change directory to %s\n", workingDirectory);
+                exit(1);
+            }
+            for(i = 0; i < 3; ++i){
+                dup2(fileDescriptors[i], i);
+            }
+            for(i = 0; i < 3; ++i){
+                close(fileDescriptors[i]);
+            }
+            if(request->isProcessGroup == TRUE){
+                startProcessGroup(request->isBackgroundCommand);
+            }
+            environ = environment;
+            //'cat' and 'cp' are run in this process, instead of starting a new program
+            if(isFileCommand(commandArguments) == TRUE){
+                exit(runFileCommand(commandArguments, STDIN_FILENO, STDOUT_FILENO, NULL));
+            }
+            execvp(commandArguments[0], commandArguments);
+            dup2(standardOutputFileDescriptor, 1);
+            printExecutionError(errno, commandArguments[0], request->isBackgroundCommand);
+            exit(1);
+        }
+        if(response.processId == -1){
+            response.errorCode = errno;
+        }
+        //set the process group here too, so it exists before the shell signals it or gives it the terminal
+        else if(request->isProcessGroup == TRUE){
+            setpgid(response.processId, response.processId);
+        }
+    }
+    for(i = 0; i < 3; ++i){
+        close(fileDescriptors[i]);
+    }
+    free(environment);
+    sendWithFileDescriptors(socket, &response, sizeof(response), NULL, 0);
+}
+
+//main loop of the fork server, which starts commands for the shell and tells it when they finish
+//it is forked when the shell starts, while the shell is as small as it will ever be,
+//so starting commands stays cheap however much memory the shell uses later on
+//exits when the shell closes its end of socket
+void runForkServer(int socket){
+    //control-c is for the shell and the foreground command, not the fork server
+    signal(SIGINT, SIG_IGN);
+    initializeChildSignalHandler();
+    //one extra byte, so the received message can be null terminated
+    char *message = malloc(FORK_SERVER_MESSAGE_SIZE + 1);
+    assert(message != NULL);
+    struct pollfd pollFileDescriptors[2];
+    pollFileDescriptors[0].fd = signalEventPipe[0];
+    pollFileDescriptors[0].events = POLLIN;
+    pollFileDescriptors[1].fd = socket;
+    pollFileDescriptors[1].events = POLLIN;
+    while(1){
+        if(poll(pollFileDescriptors, 2, -1) == -1){
+            continue;
+        }
+        //reap finished commands and send their status to the shell
+        //requests are only read after this, so a command's start is always sent before its status
+        if(pollFileDescriptors[0].revents != 0){
+            char notifications[64];
+            while(read(signalEventPipe[0], notifications, sizeof(notifications)) > 0){
+            }
+            struct ForkServerResponse response;
+            bzero(&response, sizeof(response));
+            response.type = FORK_SERVER_FINISHED;
+            int status;
+            pid_t processId;
+            while((processId = wait4(-1, &status, WNOHANG, &response.usage)) > 0){
+                response.processId = processId;
+                response.status = status;
+                sendWithFileDescriptors(socket, &response, sizeof(response), NULL, 0);
+            }
+        }
+        if(pollFileDescriptors[1].revents != 0){
+            int fileDescriptors[3];
+            int fileDescriptorCount;
+            ssize_t messageLength = receiveWithFileDescriptors(socket, message, FORK_SERVER_MESSAGE_SIZE, fileDescriptors, 3, &fileDescriptorCount);
+            //shell has exited, or a request was cut short - the shell is waiting for a reply to it,
+            //so exit and let the shell go back to starting commands itself
+            if(messageLength <= 0){
+                exit(0);
+            }
+            if(messageLength >= (ssize_t) sizeof(struct ForkServerRequest) && fileDescriptorCount == 3){
+                message[messageLength] = '\0';
+                startForkServerCommand(socket, message, messageLength, fileDescriptors);
+            }
+            else{
+                int i;
+                for(i = 0; i < fileDescriptorCount; ++i){
+                    close(fileDescriptors[i]);
+                }
+            }
+        }
+    }
+}
+
+//starts the fork server, used with --fork-server
+//called before anything else, so the fork server is as small as possible
+void startForkServer(){
+    int sockets[2];
+    if(socketpair(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0, sockets) == -1){
+        printf("could not start fork server\n");
+        return;
+    }
+    pid_t processId = fork();
+    if(processId == 0){
+        close(sockets[0]);
+        runForkServer(sockets[1]);
+    }
+    close(sockets[1]);
+    if(processId == -1){
+        close(sockets[0]);
+        printf("could not start fork server\n");
+        return;
+    }
+    //the shell only reads the socket when something is waiting, so it never blocks on it
+    fcntl(sockets[0], F_SETFL, O_NONBLOCK);
+    forkServer.socket = sockets[0];
+}
+
+//adds string and its null char to the end of fork server request message
+//returns FALSE if there isn't room for it
+BOOL appendForkServerString(char *message, size_t *messageLength, const char *string){
+    size_t stringSize = strlen(string) + 1;
+    if(*messageLength + stringSize > FORK_SERVER_MESSAGE_SIZE){
+        return FALSE;
+    }
+    memcpy(message + *messageLength, string, stringSize);
+    *messageLength += stringSize;
+    return TRUE;
+}
+
+//opens fileName for redirecting a command started by the fork server
+//non-blocking, so a fifo with nothing on the other end can't hang the shell - the command is started by forking the shell instead,
+//which waits for the fifo the usual way
+//input has to be a regular file or a device: opening a fifo for reading doesn't wait for a writer, so the command would just see end of file
+//returns the file descriptor, or -1 if it couldn't be opened or isn't suitable
+int openForkServerRedirection(const char *fileName, int flags){
+    int fileDescriptor = open(fileName, flags | O_NONBLOCK | O_CLOEXEC, 0644);
+    if(fileDescriptor == -1){
+        return -1;
+    }
+    struct stat fileStatus;
+    if((flags & O_ACCMODE) == O_RDONLY && (fstat(fileDescriptor, &fileStatus) == -1 || (!S_ISREG(fileStatus.st_mode) && !S_ISCHR(fileStatus.st_mode)))){
+        close(fileDescriptor);
+        return -1;
+    }
+    fcntl(fileDescriptor, F_SETFL, 0);
+    return fileDescriptor;
+}
+
+//waits for the fork server's reply to request requestId, handling any other messages that arrive first
+//returns pid of the started command, or -1 with errno set if it couldn't be started
+pid_t receiveForkServerStart(uint32_t requestId){
+    while(forkServer.socket != -1){
+        struct pollfd pollFileDescriptor;
+        pollFileDescriptor.fd = forkServer.socket;
+        pollFileDescriptor.events = POLLIN;
+        poll(&pollFileDescriptor, 1, -1);
+        struct ForkServerResponse response;
+        int fileDescriptorCount;
+        ssize_t bytesReceived = receiveWithFileDescriptors(forkServer.socket, &response, sizeof(response), NULL, 0, &fileDescriptorCount);
+        if(bytesReceived == 0){
+            stopForkServer();
+        }
+        else if(bytesReceived != sizeof(response)){
+            continue;
+        }
+        else if(response.type == FORK_SERVER_STARTED && response.requestId == requestId){
+            if(response.processId == -1){
+                errno = response.errorCode;
+                return -1;
+            }
+            addForkServerProcess(response.processId);
+            return response.processId;
+        }
+        else{
+            handleForkServerResponse(&response);
+        }
+    }
+    //fork server exited before replying, so there is no telling if the command was started
+    errno = ECHILD;
+    return -1;
+}
+
+//starts command in commandLineBuffer with the fork server, parsed and redirected the same way as in childProcessExecuteCommand()
+//redirection files are opened here and sent along with the command, so the fork server only has to fork and exec
+//returns pid of the new process, -1 if it couldn't be started, or FORK_SERVER_NOT_USED if the shell should fork the command itself:
+//when there is nothing to run or a redirection file can't be opened (so the child prints the usual error),
+//the command doesn't fit in a request, or the fork server has stopped
+pid_t spawnWithForkServer(char commandLineBuffer[COMMAND_LINE_MAX_LENGTH], int bufferLength, BOOL isBackgroundCommand, BOOL isProcessGroup, int captureFileDescriptor){
+    //commandLineBuffer is still needed if the shell forks the command instead, so parse a copy
+    char commandLineCopy[COMMAND_LINE_MAX_LENGTH];
+    strcpy(commandLineCopy, commandLineBuffer);
+    expandVariables(commandLineCopy, bufferLength);
+    char *commandArguments[MAX_ARGUMENT_COUNT + 1];
+    int argumentCount = parseCommandArguments(commandLineCopy, commandArguments);
+    if(argumentCount < 1){
+        return FORK_SERVER_NOT_USED;
+    }
+    char *outputFileName = parseRedirection(commandArguments, ">");
+    char *inputFileName = parseRedirection(commandArguments, "<");
+    //standard input, output and error for the command, and which of them were opened here
+    int fileDescriptors[3] = {STDIN_FILENO, STDOUT_FILENO, STDERR_FILENO};
+    BOOL isOpened[3] = {FALSE, FALSE, FALSE};
+    BOOL canStart = TRUE;
+    //background commands with no redirection use /dev/null, unless their output is being captured
+    if(outputFileName != NULL || (isBackgroundCommand == TRUE && captureFileDescriptor == -1)){
+        fileDescriptors[1] = openForkServerRedirection(outputFileName != NULL ? outputFileName : "/dev/null", O_WRONLY | O_CREAT | O_TRUNC);
+        isOpened[1] = canStart = fileDescriptors[1] != -1;
+    }
+    else if(captureFileDescriptor != -1){
+        fileDescriptors[1] = captureFileDescriptor;
+    }
+    if(captureFileDescriptor != -1){
+        fileDescriptors[2] = captureFileDescriptor;
+    }
+    if(canStart == TRUE && (inputFileName != NULL || isBackgroundCommand == TRUE)){
+        fileDescriptors[0] = openForkServerRedirection(inputFileName != NULL ? inputFileName : "/dev/null", O_RDONLY);
+        isOpened[0] = canStart = fileDescriptors[0] != -1;
+    }
+
+    pid_t processId = FORK_SERVER_NOT_USED;
+    if(canStart == TRUE){
+        char *message = malloc(FORK_SERVER_MESSAGE_SIZE);
+        assert(message != NULL);
+        struct ForkServerRequest *request = (struct ForkServerRequest *) message;
+        bzero(request, sizeof(struct ForkServerRequest));
+        request->requestId = forkServer.nextRequestId++;
+        request->isBackgroundCommand = isBackgroundCommand;
+        request->isProcessGroup = isProcessGroup;
+        size_t messageLength = sizeof(struct ForkServerRequest);
+        char workingDirectory[PATH_MAX];
+        BOOL isMessageComplete = getcwd(workingDirectory, sizeof(workingDirectory)) != NULL && appendForkServerString(message, &messageLength, workingDirectory);
+        //arguments end at the first NULL, like they do for execvp()
+        while(isMessageComplete == TRUE && commandArguments[request->argumentCount] != NULL){
+            isMessageComplete = appendForkServerString(message, &messageLength, commandArguments[request->argumentCount]);
+            request->argumentCount++;
+        }
+        while(isMessageComplete == TRUE && environ[request->environmentCount] != NULL){
+            isMessageComplete = appendForkServerString(message, &messageLength, environ[request->environmentCount]);
+            request->environmentCount++;
+        }
+        if(isMessageComplete == TRUE){
+            if(sendWithFileDescriptors(forkServer.socket, message, messageLength, fileDescriptors, 3) == TRUE){
+                processId = receiveForkServerStart(request->requestId);
+            }
+            else{
+                stopForkServer();
+            }
+        }
+        free(message);
+    }
+
+    int i;
+    for(i = 0; i < 3; ++i){
+        if(isOpened[i] == TRUE){
+            close(fileDescriptors[i]);
+        }
+    }
+    free(outputFileName);
+    free(inputFileName);
+    //redirection leaves gaps in commandArguments, so free everything left instead of stopping at the first NULL
+    for(i = 0; i < argumentCount; ++i){
+        free(commandArguments[i]);
+    }
+    return processId;
+}
+
+
 ////////////////////////////////////////
-//Parse Argument functions
+// Main command execution function
 ////////////////////////////////////////
 
-//parses commands and arguments in commandLineBuffer and splits into array at whitespace
-//commandArguments should be empty array where return value is stored and last item is NULL
-//allocates memory for strings in commandArguments so should be destroyed afterwards
-//commandLineBuffer is altered by strtok
-//returns length of commandArguments array
-int parseCommandArguments(char commandLineBuffer[COMMAND_LINE_MAX_LENGTH], char *commandArguments[MAX_ARGUMENT_COUNT + 1]){
-    //pointer used by strtok_r to store position in string
-    char *save;
-    //initialize variable to hold current position in array
-    int i = 0;
-    //initialize strtok with commandLineBuffer
-    char *currentWord = strtok_r(commandLineBuffer, " ", &save);
+//creates a separate process that executes command given in commandLineBuffer
+//used by everything that runs commands, so they all go through the same parsing, redirection and exec
+//isProcessGroup is TRUE if the command should run in its own process group
+//captureFileDescriptor is the pipe to capture output in, or -1
+//returns pid of the new process, or -1 if it couldn't be created
+//(the child process never returns, since childProcessExecuteCommand exits)
+pid_t spawnCommand(char commandLineBuffer[COMMAND_LINE_MAX_LENGTH], int bufferLength, BOOL isBackgroundCommand, BOOL isProcessGroup, int captureFileDescriptor){
+    //anything already printed has to come out before the command's output,
+    //and not be printed again by a child that exits without exec (like 'cat' and 'cp')
+    fflush(stdout);
+    //with --fork-server, the fork server starts commands instead
+    if(forkServer.socket != -1){
+        pid_t processId = spawnWithForkServer(commandLineBuffer, bufferLength, isBackgroundCommand, isProcessGroup, captureFileDescriptor);
+        if(processId != FORK_SERVER_NOT_USED){
+            return processId;
+        }
+    }
+    pid_t processId = fork();
+    //child process executing command
+    if(processId == 0){
+        childProcessExecuteCommand(commandLineBuffer, bufferLength, isBackgroundCommand, isProcessGroup, captureFileDescriptor);
+    }
+    return processId;
+}
+
+//creates a separate process to execute command given in commandLineBuffer and then
+//executes the command
+//return 0 if process succeeded, or 1 if it doesn't
+//deadline is NULL if the command has no deadline
+//used for commands started straight away, and for background commands started from the admission queue
+//based on: https://support.sas.com/documentation/onlinedoc/sasc/doc/lr2/waitpid.htm
+int startCommand(char commandLineBuffer[COMMAND_LINE_MAX_LENGTH], int bufferLength, struct BackgroundProcessList *backgroundProcessList, BOOL isBackgroundCommand, const struct CommandDeadline *deadline){
+    //latency is measured from just before fork() until the process is reaped
+    struct CommandStats *commandStats = getCommandStatsForLine(commandLineBuffer);
+    struct timespec startTime;
+    getMonotonicTime(&startTime);
+    //capture output of background commands, if turned on with 'joblog on'
+    int captureFileDescriptor = -1;
+    struct JobLog *jobLog = NULL;
+    if(isBackgroundCommand == TRUE && jobLogs.isCapturing == TRUE){
+        jobLog = createJobLog(commandLineBuffer, &captureFileDescriptor);
+    }
+    //create new child process to execute command
+    pid_t processId = spawnCommand(commandLineBuffer, bufferLength, isBackgroundCommand, deadline != NULL, captureFileDescriptor);
+    //only the child writes to the capture pipe, so the log ends when it (and anything it started) exits
+    if(jobLog != NULL){
+        close(captureFileDescriptor);
+        if(processId == -1){
+            destroyJobLog(jobLog);
+        }
+        else{
+            jobLog->processId = processId;
+        }
+    }
+
+    //branch based on process id:
+    //parent waits for child if it is in the foreground or
+    //adds to background processes if it is in the background
+    switch(processId){
+        //error with fork
+        case -1:
+            printf("Could not create new process to execute %s\n", commandLineBuffer);
+            return 1;
+            break;
+        //parent process
+        //wait for child to finish executing (if done in foreground) and return result
+        //otherwise just add to background processes and return 0
+        default:
+            return parentProcessExecuteCommand(processId, backgroundProcessList, isBackgroundCommand, deadline, commandStats, &startTime);
+            break;
+    }
+}
+
+
+//executes command given in commandLineBuffer
+//background commands are queued instead if admission control is on and the system is under pressure
+//return 0 if process succeeded, or 1 if it doesn't
+//deadline is NULL unless command was run with 'timeout'
+int executeCommand(char commandLineBuffer[COMMAND_LINE_MAX_LENGTH], int bufferLength, struct BackgroundProcessList *backgroundProcessList, const struct CommandDeadline *deadline){
+    //find out if command should be executed in background
+    BOOL isBackgroundCommand = shouldExecuteInBackground(commandLineBuffer, bufferLength);
+    //background commands without their own deadline get the default one
+    if(isBackgroundCommand == TRUE && deadline == NULL && hasBackgroundDefaultDeadline == TRUE){
+        deadline = &backgroundDefaultDeadline;
+    }
+    if(isBackgroundCommand == TRUE && shouldAdmitCommand(backgroundProcessList) == FALSE){
+        queueCommand(commandLineBuffer, deadline);
+        printf("background command queued (%d waiting)\n", admissionController.queueLength);
+        return 0;
+    }
+    return startCommand(commandLineBuffer, bufferLength, backgroundProcessList, isBackgroundCommand, deadline);
+}
+
+//starts queued background commands, oldest first, for as long as there is room for them
+//called when the admission timer goes off, so the queue drains as pressure falls
+void startQueuedCommands(struct BackgroundProcessList *backgroundProcessList){
+    if(admissionController.waitStats == NULL){
+        admissionController.waitStats = calloc(1, sizeof(struct CommandStats));
+        assert(admissionController.waitStats != NULL);
+    }
+    admissionController.isStartingQueued = TRUE;
+    while(admissionController.head != NULL && (admissionController.isEnabled == FALSE || hasAdmissionCapacity(backgroundProcessList))){
+        struct QueuedCommand *queuedCommand = dequeueCommand();
+        uint64_t queuedMicroseconds = getElapsedMicroseconds(&queuedCommand->queuedAt);
+        recordCommandStats(admissionController.waitStats, 0, &queuedCommand->queuedAt);
+        //command line is changed while it is parsed, so give it a copy
+        char commandLineBuffer[COMMAND_LINE_MAX_LENGTH];
+        strcpy(commandLineBuffer, queuedCommand->commandLine);
+        struct BackgroundProcessNode *previousHead = backgroundProcessList->head;
+        //start command the way it would have been started when it was queued:
+        //in the same directory (which its redirection files are relative to) and with the same 'joblog' setting
+        //the shell's own directory and setting are put back afterwards
+        int shellDirectoryFileDescriptor = -1;
+        if(queuedCommand->directoryFileDescriptor != -1){
+            shellDirectoryFileDescriptor = open(".", O_PATH | O_DIRECTORY | O_CLOEXEC);
+            fchdir(queuedCommand->directoryFileDescriptor);
+        }
+        BOOL isCapturing = jobLogs.isCapturing;
+        jobLogs.isCapturing = queuedCommand->isCapturing;
+        //command belongs to the line it was queued from, not whatever line is running now
+        struct JournalLine *currentLine = journal.currentLine;
+        journal.currentLine = queuedCommand->journalLine;
+        startCommand(commandLineBuffer, strlen(commandLineBuffer), backgroundProcessList, TRUE, queuedCommand->hasDeadline == TRUE ? &queuedCommand->deadline : NULL);
+        journal.currentLine = currentLine;
+        jobLogs.isCapturing = isCapturing;
+        if(shellDirectoryFileDescriptor != -1){
+            fchdir(shellDirectoryFileDescriptor);
+            close(shellDirectoryFileDescriptor);
+        }
+        releaseJournalLine(queuedCommand->journalLine);
+        //new process is added to the front of the list, unless it couldn't be started
+        if(backgroundProcessList->head != previousHead){
+            backgroundProcessList->head->queuedMicroseconds = queuedMicroseconds;
+        }
+        destroyQueuedCommand(queuedCommand);
+    }
+    admissionController.isStartingQueued = FALSE;
+}
+
+
+/*************************************
+* 'timeout' functions
+**************************************/
+
+//prints how to use 'timeout'
+//returns 1, since it is only printed when 'timeout' is used incorrectly
+int printTimeoutUsage(){
+    printf("usage: timeout DURATION [--signal SIG] [--kill-after DURATION] command\n");
+    printf("       timeout --background [DURATION|off] [--signal SIG] [--kill-after DURATION]\n");
+    return 1;
+}
+
+//reads the value of an option that is either given as '--option=value' or as the next word
+//word is the option as typed, and valueOffset is where the value starts if it was given with '='
+//returns FALSE if there is no value
+BOOL readOptionValue(char word[COMMAND_LINE_MAX_LENGTH], int valueOffset, char **cursor, char value[COMMAND_LINE_MAX_LENGTH]){
+    if(valueOffset > 0 && word[valueOffset - 1] == '='){
+        strcpy(value, &word[valueOffset]);
+        return TRUE;
+    }
+    return readNextWord(cursor, value);
+}
+
+//executes 'timeout' command in commandLineBuffer
+//'timeout DURATION [options] command' runs command and signals its whole process group if it runs longer than DURATION
+//'timeout --background DURATION [options]' sets the default deadline for background commands, and 'off' removes it
+//returns status code of command, or 1 if timeout was used incorrectly
+int executeTimeout(char commandLineBuffer[COMMAND_LINE_MAX_LENGTH], int bufferLength, struct BackgroundProcessList *backgroundProcessList){
+    struct CommandDeadline deadline;
+    bzero(&deadline, sizeof(deadline));
+    deadline.signalNumber = SIGTERM;
+    BOOL hasDuration = FALSE;
+    BOOL isBackgroundDefault = FALSE;
+    BOOL isOff = FALSE;
+    //where the command to run starts in commandLineBuffer
+    char *commandStart = NULL;
+    //skip over 'timeout'
+    char *cursor = &commandLineBuffer[strlen("timeout")];
+    char word[COMMAND_LINE_MAX_LENGTH];
+    char value[COMMAND_LINE_MAX_LENGTH];
+    while(1){
+        char *wordStart = cursor;
+        if(readNextWord(&cursor, word) == FALSE){
+            break;
+        }
+        //options have to come before the command
+        if(strcmp(word, "--signal") == 0 || strcmp(word, "-s") == 0 || strncmp(word, "--signal=", 9) == 0){
+            if(readOptionValue(word, word[1] == 's' ? 0 : 9, &cursor, value) == FALSE){
+                return printTimeoutUsage();
+            }
+            deadline.signalNumber = parseSignal(value);
+            if(deadline.signalNumber == -1){
+                printf("timeout: unknown signal %s\n", value);
+                return 1;
+            }
+        }
+        else if(strcmp(word, "--kill-after") == 0 || strcmp(word, "-k") == 0 || strncmp(word, "--kill-after=", 13) == 0){
+            if(readOptionValue(word, word[1] == 'k' ? 0 : 13, &cursor, value) == FALSE){
+                return printTimeoutUsage();
+            }
+            if(parseDuration(value, &deadline.killAfter) == FALSE){
+                printf("timeout: invalid duration %s\n", value);
+                return 1;
+            }
+        }
+        else if(strcmp(word, "--background") == 0 || strcmp(word, "-b") == 0){
+            isBackgroundDefault = TRUE;
+        }
+        else if(hasDuration == TRUE){
+            commandStart = wordStart;
+            break;
+        }
+        else if(isBackgroundDefault == TRUE && strcmp(word, "off") == 0){
+            isOff = TRUE;
+            hasDuration = TRUE;
+        }
+        else if(parseDuration(word, &deadline.duration) == TRUE){
+            hasDuration = TRUE;
+        }
+        else{
+            printf("timeout: invalid duration %s\n", word);
+            return 1;
+        }
+    }
+
+    if(isBackgroundDefault == TRUE){
+        if(commandStart != NULL){
+            return printTimeoutUsage();
+        }
+        //just print the current default
+        if(hasDuration == FALSE){
+            if(hasBackgroundDefaultDeadline == FALSE){
+                printf("no default deadline for background commands\n");
+            }
+            else{
+                printf("background commands are sent signal %d after %ld.%03lds\n", backgroundDefaultDeadline.signalNumber, (long) backgroundDefaultDeadline.duration.tv_sec, backgroundDefaultDeadline.duration.tv_nsec / 1000000);
+            }
+            return 0;
+        }
+        //a duration of 0 also turns the default off
+        hasBackgroundDefaultDeadline = isOff == FALSE && !isTimespecZero(&deadline.duration);
+        backgroundDefaultDeadline = deadline;
+        return 0;
+    }
+
+    if(hasDuration == FALSE || commandStart == NULL){
+        return printTimeoutUsage();
+    }
+    //copy command into its own buffer, since executeCommand() expects it at the start
+    char timedCommandBuffer[COMMAND_LINE_MAX_LENGTH];
+    strcpy(timedCommandBuffer, commandStart);
+    //a duration of 0 means no deadline
+    return executeCommand(timedCommandBuffer, strlen(timedCommandBuffer), backgroundProcessList, isTimespecZero(&deadline.duration) ? NULL : &deadline);
+}
+
+
+///////////////////////////////////////////////////////////
+// Background process commands
+///////////////////////////////////////////////////////////
+
+//prints pid of process started from the admission queue, if it hasn't been printed yet
+void announceBackgroundProcess(struct BackgroundProcessNode *node){
+    if(node->isAnnouncePending == FALSE){
+        return;
+    }
+    char queuedTime[32];
+    formatMicroseconds(node->queuedMicroseconds, queuedTime);
+    printf("background pid is %ld (queued for %s)\n", (long) node->processId, queuedTime);
+    node->isAnnouncePending = FALSE;
+}
+
+//prints out status of completed background process in node, adds it to its command's statistics
+//and removes it from the list
+//status is the int from waitpid
+void reportBackgroundProcess(struct BackgroundProcessNode *node, int status, struct BackgroundProcessList *backgroundProcessList){
+    announceBackgroundProcess(node);
+    //print out exit status of completed process in format
+    //background pid 4923 is done: exit value 0
+    //or
+    //background pid 4941 is done: terminated by signal 15
+    //based on: https://linux.die.net/man/3/waitpid
+    //check for exiting normally
+    if(WIFEXITED(status)){
+        printf("background pid %ld is done: exit value %d\n", (long) node->processId, WEXITSTATUS(status));
+    }
+    else if(status == LOST_PROCESS_STATUS){
+        printf("background pid %ld is done: exit value unknown\n", (long) node->processId);
+    }
+    //otherwise killed by signal
+    else{
+        printf("background pid %ld is done: terminated by signal %d\n", (long) node->processId, WTERMSIG(status));
+    }
+    recordCommandStats(node->commandStats, status, &node->startTime);
+    releaseJournalLine(node->journalLine);
+    //remove completed process from the list
+    removeFromBackgroundProcessList(node, backgroundProcessList);
+}
+
+//prints out status of completed background processes
+//and removes completed background processes from the list
+void printBackgroundProcessStatus(struct BackgroundProcessList *backgroundProcessList){
+    struct BackgroundProcessNode *node = backgroundProcessList->head;
+    //print pids of processes started from the admission queue first, oldest first
+    //(list has the newest process first)
+    while(node != NULL && node->next != NULL){
+        node = node->next;
+    }
+    for(; node != NULL; node = node->previous){
+        announceBackgroundProcess(node);
+    }
+    node = backgroundProcessList->head;
+    //initialize variable for status information in waitpid
+    int status = 0;
+    //iterate through all background processes, stopping them and freeing memory from the list
+    while(node != NULL){
+        //check process to see if still running
+        //don't do anything if process is still running
+        if(reapBackgroundProcess(node, backgroundProcessList, &status) == FALSE){
+            //process still running, continue with next node
+            node = node->next;
+            continue;
+        }
+        //duplicate node, so we can store pointer to next node
+        //before deleting current node
+        struct BackgroundProcessNode *garbage = node;
+        node = node->next;
+        //free memory for current node
+        reportBackgroundProcess(garbage, status, backgroundProcessList);
+    }
+}
+
+/*************************************
+* 'wait' functions
+**************************************/
+
+//returns node for background process with pid, or NULL if there isn't one
+struct BackgroundProcessNode * findBackgroundProcess(pid_t pid, struct BackgroundProcessList *backgroundProcessList){
+    struct BackgroundProcessNode *node;
+    for(node = backgroundProcessList->head; node != NULL; node = node->next){
+        if(node->processId == pid){
+            return node;
+        }
+    }
+    return NULL;
+}
+
+//returns TRUE if pid is in pids, or if pids is empty, since that means every background process
+BOOL isWaitingForPid(pid_t pid, pid_t pids[MAX_ARGUMENT_COUNT], int pidCount){
+    if(pidCount == 0){
+        return TRUE;
+    }
+    int i;
+    for(i = 0; i < pidCount; ++i){
+        if(pids[i] == pid){
+            return TRUE;
+        }
+    }
+    return FALSE;
+}
+
+//executes 'wait' command in commandLineBuffer
+//'wait' waits for all background processes, 'wait PID...' waits for the given ones
+//and 'wait -n [PID...]' waits for the first of them to finish
+//finished processes are reported the same way as when printBackgroundProcessStatus() finds them
+//blocks on SIGCHLD through waitForShellEvent(), and returns early if interrupted by control-c
+//returns the exit value of the last process waited for (for 'wait PID...' the last one given), or 1 if
+//interrupted or a pid isn't a background process
+//if that process was terminated by a signal, it is recorded for printStatus() as if the foreground process was
+int executeWait(char commandLineBuffer[COMMAND_LINE_MAX_LENGTH], struct BackgroundProcessList *backgroundProcessList){
+    pid_t pids[MAX_ARGUMENT_COUNT];
+    int pidCount = 0;
+    BOOL isWaitingForAny = FALSE;
+    BOOL hasInvalidPid = FALSE;
+    //skip over 'wait'
+    char *cursor = &commandLineBuffer[strlen("wait")];
+    char word[COMMAND_LINE_MAX_LENGTH];
+    while(readNextWord(&cursor, word) == TRUE && pidCount < MAX_ARGUMENT_COUNT){
+        if(strcmp(word, "-n") == 0){
+            isWaitingForAny = TRUE;
+            continue;
+        }
+        char *end;
+        long pid = strtol(word, &end, 10);
+        if(*end != '\0' || pid <= 0){
+            printf("usage: wait [-n] [PID...]\n");
+            return 1;
+        }
+        if(findBackgroundProcess(pid, backgroundProcessList) == NULL){
+            printf("wait: pid %ld is not a background process\n", pid);
+            hasInvalidPid = TRUE;
+            continue;
+        }
+        pids[pidCount++] = pid;
+    }
+    //every pid given was invalid, so there is nothing to wait for
+    if(hasInvalidPid == TRUE && pidCount == 0){
+        return 1;
+    }
+    //status of the process whose status will be returned, and whether it has finished
+    int returnedStatus = 0;
+    BOOL hasReturnedStatus = FALSE;
+    //pid whose status is returned by 'wait PID...'
+    pid_t lastPid = pidCount > 0 ? pids[pidCount - 1] : 0;
+    //reset before checking processes, so an interrupt is never missed
+    interruptReceived = 0;
+    while(1){
+        BOOL isStillWaiting = FALSE;
+        //for 'wait -n', the finished process that finished first
+        struct BackgroundProcessNode *firstFinished = NULL;
+        struct BackgroundProcessNode *node = backgroundProcessList->head;
+        while(node != NULL){
+            struct BackgroundProcessNode *next = node->next;
+            int status = 0;
+            if(isWaitingForPid(node->processId, pids, pidCount) == FALSE){
+                node = next;
+                continue;
+            }
+            if(reapBackgroundProcess(node, backgroundProcessList, &status) == FALSE){
+                isStillWaiting = TRUE;
+                node = next;
+                continue;
+            }
+            //the list has the newest process first, which isn't necessarily the one that finished first
+            if(isWaitingForAny == TRUE){
+                if(firstFinished == NULL || node->finishOrder < firstFinished->finishOrder){
+                    firstFinished = node;
+                }
+                node = next;
+                continue;
+            }
+            if(pidCount == 0 || node->processId == lastPid){
+                returnedStatus = status;
+                hasReturnedStatus = TRUE;
+            }
+            reportBackgroundProcess(node, status, backgroundProcessList);
+            node = next;
+        }
+        //only one process is reported by 'wait -n'
+        if(firstFinished != NULL){
+            returnedStatus = firstFinished->finishedStatus;
+            hasReturnedStatus = TRUE;
+            reportBackgroundProcess(firstFinished, returnedStatus, backgroundProcessList);
+            isStillWaiting = FALSE;
+        }
+        //'wait' and 'wait -n' also wait for queued background commands to start (and finish)
+        if(pidCount == 0 && admissionController.head != NULL && !(isWaitingForAny == TRUE && hasReturnedStatus == TRUE)){
+            isStillWaiting = TRUE;
+        }
+        if(isStillWaiting == FALSE){
+            break;
+        }
+        if(interruptReceived){
+            printf("\n");
+            return 1;
+        }
+        waitForShellEvent(-1, -1, backgroundProcessList);
+    }
+    //'wait -n' with no background processes
+    if(isWaitingForAny == TRUE && hasReturnedStatus == FALSE){
+        return 1;
+    }
+    if(WIFSIGNALED(returnedStatus)){
+        foregroundInterrupted = TRUE;
+        foregroundInterruptSignal = WTERMSIG(returnedStatus);
+        return 1;
+    }
+    if(hasInvalidPid == TRUE){
+        return 1;
+    }
+    if(returnedStatus == LOST_PROCESS_STATUS){
+        return LOST_PROCESS_STATUS;
+    }
+    return WEXITSTATUS(returnedStatus);
+}
+
+
+/*************************************
+* 'taskrun' functions
+**************************************/
+
+//states of a task run by 'taskrun'
+#define TASK_WAITING 0
+#define TASK_READY 1
+#define TASK_RUNNING 2
+#define TASK_SUCCEEDED 3
+#define TASK_FAILED 4
+//a dependency failed, so task was never run
+#define TASK_SKIPPED 5
+//task's file is newer than its dependencies, so it didn't need to run
+#define TASK_UP_TO_DATE 6
+
+//task from a task file
+struct Task{
+    char name[COMMAND_LINE_MAX_LENGTH];
+    //command line to run - empty for tasks that just group their dependencies
+    char commandLineBuffer[COMMAND_LINE_MAX_LENGTH];
+    //indexes of tasks this task depends on, and of tasks that depend on this one
+    int *dependencies;
+    int dependencyCount;
+    int *dependents;
+    int dependentCount;
+    //names of dependencies that aren't tasks, but existing files (only used for up to date checks)
+    char **fileDependencies;
+    int fileDependencyCount;
+    //dependencies that haven't finished yet
+    int remainingDependencyCount;
+    //TRUE if task is needed for the tasks being run
+    BOOL isSelected;
+    int state;
+    pid_t processId;
+    //times in microseconds since the run started
+    uint64_t startMicroseconds;
+    uint64_t endMicroseconds;
+    int status;
+};
+
+//tasks read from a task file
+struct TaskGraph{
+    struct Task *tasks;
+    int taskCount;
+    int taskCapacity;
+};
+
+//returns index of task called name, or -1 if there isn't one
+int findTask(struct TaskGraph *graph, const char *name){
+    int i;
+    for(i = 0; i < graph->taskCount; ++i){
+        if(strcmp(graph->tasks[i].name, name) == 0){
+            return i;
+        }
+    }
+    return -1;
+}
+
+//appends value to the array at *array, which holds *count ints
+void appendToIntArray(int **array, int *count, int value){
+    *array = realloc(*array, sizeof(int) * (*count + 1));
+    assert(*array != NULL);
+    (*array)[(*count)++] = value;
+}
+
+//frees memory used by tasks in graph
+void destroyTaskGraph(struct TaskGraph *graph){
+    int i;
+    for(i = 0; i < graph->taskCount; ++i){
+        struct Task *task = &graph->tasks[i];
+        free(task->dependencies);
+        free(task->dependents);
+        int j;
+        for(j = 0; j < task->fileDependencyCount; ++j){
+            free(task->fileDependencies[j]);
+        }
+        free(task->fileDependencies);
+    }
+    free(graph->tasks);
+}
+
+//reads task file at path into graph
+//each task is a line 'name: dependency...' followed by an indented line with its command, for example
+//  build: fetch configure
+//      make -j4
+//lines starting with '#' are comments
+//returns FALSE and prints the problem if the file couldn't be read or is invalid
+BOOL readTaskFile(const char *path, struct TaskGraph *graph){
+    FILE *taskFile = fopen(path, "r");
+    if(taskFile == NULL){
+        printf("taskrun: cannot open %s\n", path);
+        return FALSE;
+    }
+    //dependency names are kept as text until all tasks have been read,
+    //since tasks can depend on tasks defined later in the file
+    char **dependencyLines = NULL;
+    char line[COMMAND_LINE_MAX_LENGTH];
+    int lineNumber = 0;
+    BOOL isValid = TRUE;
+    while(isValid == TRUE && fgets(line, sizeof(line), taskFile) != NULL){
+        lineNumber++;
+        line[strcspn(line, "\n")] = '\0';
+        char *cursor = line;
+        char word[COMMAND_LINE_MAX_LENGTH];
+        //skip blank lines and comments
+        if(readNextWord(&cursor, word) == FALSE || word[0] == COMMENT_CHAR){
+            continue;
+        }
+        //indented line is the command of the last task
+        if(isspace(line[0])){
+            if(graph->taskCount == 0 || graph->tasks[graph->taskCount - 1].commandLineBuffer[0] != '\0'){
+                printf("taskrun: %s line %d: command without a task\n", path, lineNumber);
+                isValid = FALSE;
+                continue;
+            }
+            char *command = line;
+            while(isspace(*command)){
+                command++;
+            }
+            //each task is started as one process, so it can't be a list of commands
+            if(hasListOperator(command) == TRUE){
+                printf("taskrun: %s line %d: a task's command can't contain ';', '&&', '||' or '&' (put the commands in a script instead)\n", path, lineNumber);
+                isValid = FALSE;
+                continue;
+            }
+            strcpy(graph->tasks[graph->taskCount - 1].commandLineBuffer, command);
+            continue;
+        }
+        char *colon = strchr(line, ':');
+        if(colon == NULL){
+            printf("taskrun: %s line %d: expected 'name: dependencies'\n", path, lineNumber);
+            isValid = FALSE;
+            continue;
+        }
+        *colon = '\0';
+        cursor = line;
+        char extraWord[COMMAND_LINE_MAX_LENGTH];
+        if(readNextWord(&cursor, word) == FALSE || readNextWord(&cursor, extraWord) == TRUE){
+            printf("taskrun: %s line %d: task name must be one word\n", path, lineNumber);
+            isValid = FALSE;
+            continue;
+        }
+        if(findTask(graph, word) != -1){
+            printf("taskrun: %s line %d: task %s is already defined\n", path, lineNumber, word);
+            isValid = FALSE;
+            continue;
+        }
+        if(graph->taskCount == graph->taskCapacity){
+            graph->taskCapacity = graph->taskCapacity == 0 ? 16 : graph->taskCapacity * 2;
+            graph->tasks = realloc(graph->tasks, sizeof(struct Task) * graph->taskCapacity);
+            dependencyLines = realloc(dependencyLines, sizeof(char *) * graph->taskCapacity);
+            assert(graph->tasks != NULL && dependencyLines != NULL);
+        }
+        struct Task *task = &graph->tasks[graph->taskCount];
+        bzero(task, sizeof(struct Task));
+        strcpy(task->name, word);
+        dependencyLines[graph->taskCount] = strdup(colon + 1);
+        assert(dependencyLines[graph->taskCount] != NULL);
+        graph->taskCount++;
+    }
+    fclose(taskFile);
+
+    //link tasks to their dependencies
+    int i;
+    for(i = 0; i < graph->taskCount; ++i){
+        if(isValid == TRUE){
+            char *cursor = dependencyLines[i];
+            char word[COMMAND_LINE_MAX_LENGTH];
+            while(readNextWord(&cursor, word) == TRUE){
+                int dependency = findTask(graph, word);
+                struct stat fileInfo;
+                if(dependency != -1){
+                    appendToIntArray(&graph->tasks[i].dependencies, &graph->tasks[i].dependencyCount, dependency);
+                    appendToIntArray(&graph->tasks[dependency].dependents, &graph->tasks[dependency].dependentCount, i);
+                }
+                //dependencies that aren't tasks have to be existing files
+                else if(stat(word, &fileInfo) == 0){
+                    graph->tasks[i].fileDependencies = realloc(graph->tasks[i].fileDependencies, sizeof(char *) * (graph->tasks[i].fileDependencyCount + 1));
+                    assert(graph->tasks[i].fileDependencies != NULL);
+                    graph->tasks[i].fileDependencies[graph->tasks[i].fileDependencyCount] = strdup(word);
+                    graph->tasks[i].fileDependencyCount++;
+                }
+                else{
+                    printf("taskrun: task %s depends on %s, which is not a task or a file\n", graph->tasks[i].name, word);
+                    isValid = FALSE;
+                    break;
+                }
+            }
+        }
+        free(dependencyLines[i]);
+    }
+    free(dependencyLines);
+    return isValid;
+}
 
-    //continue until no more arguments in buffer or we have reached argument count limit
-    while( i < MAX_ARGUMENT_COUNT && currentWord != NULL){
-        //need to allocate and copy space for word or it will
-        //be cleaned up once we exit function
-        char *savedWord = malloc(strlen(currentWord) + 1);
-        //sanity check for malloc
-        assert(savedWord != NULL);
-        //copy currentWord so it can be saved
-        strcpy(savedWord, currentWord);
+//marks task and everything it depends on as selected to run
+void selectTask(struct TaskGraph *graph, int taskIndex){
+    struct Task *task = &graph->tasks[taskIndex];
+    if(task->isSelected == TRUE){
+        return;
+    }
+    task->isSelected = TRUE;
+    int i;
+    for(i = 0; i < task->dependencyCount; ++i){
+        selectTask(graph, task->dependencies[i]);
+    }
+}
 
-        commandArguments[i] = savedWord;
-        i++;
-        //after the first time, call strtok with NULL
-        currentWord = strtok_r(NULL, " ", &save);
+//returns TRUE if a file named after task exists and is at least as new as all of its dependencies
+//dependencies that are tasks are compared using files named after them, like make does
+BOOL isTaskUpToDate(struct TaskGraph *graph, struct Task *task){
+    struct stat taskInfo;
+    if(stat(task->name, &taskInfo) != 0){
+        return FALSE;
     }
-    //make sure last item is NULL
-    commandArguments[i] = NULL;
-    return i;
+    struct stat dependencyInfo;
+    int i;
+    for(i = 0; i < task->dependencyCount; ++i){
+        if(stat(graph->tasks[task->dependencies[i]].name, &dependencyInfo) != 0 || compareTimespec(&dependencyInfo.st_mtim, &taskInfo.st_mtim) > 0){
+            return FALSE;
+        }
+    }
+    for(i = 0; i < task->fileDependencyCount; ++i){
+        if(stat(task->fileDependencies[i], &dependencyInfo) != 0 || compareTimespec(&dependencyInfo.st_mtim, &taskInfo.st_mtim) > 0){
+            return FALSE;
+        }
+    }
+    return TRUE;
 }
 
-//checks arguments for "token <filename>" and returns the string matching "<filename>"
-//also replaces "token" and "<filename>" with NULL in arguments so they will not be executed
-//returns NULL if there is no redirection
-//'>' is token for output redirection, '<' is token for input redirection
-char * parseRedirection(char *commandArguments[MAX_ARGUMENT_COUNT + 1], char *token){
-    //if last character was token the next string is the filename
-    BOOL previousArgWasToken = FALSE;
-    //iterate through arguments until we reach null, since that indicates the end of the arguments
-    int i = 0;
-    char *currentArgument;
-    while((currentArgument = commandArguments[i]) != NULL){
-        //if previous argument was token this should be the redirection filename
-        if(previousArgWasToken == TRUE){
-            //replace value in array with NULL, so won't be executed
-            commandArguments[i] = NULL;
-            return currentArgument;
+//marks every task that depends on task, directly or not, as skipped
+void skipTaskDependents(struct TaskGraph *graph, struct Task *task, const char *failedTaskName){
+    int i;
+    for(i = 0; i < task->dependentCount; ++i){
+        struct Task *dependent = &graph->tasks[task->dependents[i]];
+        if(dependent->isSelected == FALSE || dependent->state == TASK_SKIPPED){
+            continue;
         }
-        //if token, free string and replace with null
-        //and set flag
-        else if(strcmp(currentArgument, token) == 0){
-            previousArgWasToken = TRUE;
-            //erase from arguments so it won't be executed
-            commandArguments[i] = NULL;
-            //free memory allocated for ">"
-            free(currentArgument);
+        dependent->state = TASK_SKIPPED;
+        printf("task %s skipped: %s failed\n", dependent->name, failedTaskName);
+        skipTaskDependents(graph, dependent, failedTaskName);
+    }
+}
+
+//records that task finished with state, and makes dependents whose dependencies are now all done ready to run
+void finishTask(struct TaskGraph *graph, struct Task *task, int state, uint64_t endMicroseconds){
+    task->state = state;
+    task->endMicroseconds = endMicroseconds;
+    if(state == TASK_FAILED){
+        skipTaskDependents(graph, task, task->name);
+        return;
+    }
+    int i;
+    for(i = 0; i < task->dependentCount; ++i){
+        struct Task *dependent = &graph->tasks[task->dependents[i]];
+        dependent->remainingDependencyCount--;
+        if(dependent->isSelected == TRUE && dependent->state == TASK_WAITING && dependent->remainingDependencyCount == 0){
+            dependent->state = TASK_READY;
+        }
+    }
+}
+
+//prints the chain of tasks that determined how long the run took:
+//starting from the task that finished last, each task's dependency that finished last
+void printCriticalPath(struct TaskGraph *graph){
+    struct Task *last = NULL;
+    int i;
+    for(i = 0; i < graph->taskCount; ++i){
+        struct Task *task = &graph->tasks[i];
+        if((task->state == TASK_SUCCEEDED || task->state == TASK_FAILED) && (last == NULL || task->endMicroseconds > last->endMicroseconds)){
+            last = task;
+        }
+    }
+    if(last == NULL){
+        return;
+    }
+    //collect path backwards, then print it forwards
+    struct Task **path = malloc(sizeof(struct Task *) * graph->taskCount);
+    assert(path != NULL);
+    int pathLength = 0;
+    uint64_t busyMicroseconds = 0;
+    struct Task *task = last;
+    while(task != NULL){
+        path[pathLength++] = task;
+        busyMicroseconds += task->endMicroseconds - task->startMicroseconds;
+        struct Task *previous = NULL;
+        for(i = 0; i < task->dependencyCount; ++i){
+            struct Task *dependency = &graph->tasks[task->dependencies[i]];
+            if(dependency->state == TASK_SUCCEEDED && (previous == NULL || dependency->endMicroseconds > previous->endMicroseconds)){
+                previous = dependency;
+            }
+        }
+        task = previous;
+    }
+    char formatted[32];
+    formatMicroseconds(last->endMicroseconds, formatted);
+    printf("critical path %s", formatted);
+    formatMicroseconds(busyMicroseconds, formatted);
+    printf(" (%s running): ", formatted);
+    for(i = pathLength - 1; i >= 0; --i){
+        formatMicroseconds(path[i]->endMicroseconds - path[i]->startMicroseconds, formatted);
+        printf("%s (%s)%s", path[i]->name, formatted, i > 0 ? " -> " : "\n");
+    }
+    free(path);
+}
+
+//prints how to use 'taskrun'
+//returns 1, since it is only printed when 'taskrun' is used incorrectly
+int printTaskrunUsage(){
+    printf("usage: taskrun [-j JOBS] [-u] TASKFILE [TASK...]\n");
+    return 1;
+}
+
+//executes 'taskrun' command in commandLineBuffer
+//runs the tasks in a task file (or just the given tasks and what they depend on) in dependency order
+//a task starts as soon as all its dependencies have succeeded, with at most -j tasks running at once
+//when a task fails, tasks that depend on it are skipped, but unrelated tasks keep running
+//with -u, tasks whose file is newer than their dependencies are skipped as up to date
+//each task is run by spawnCommand(), like any other command
+//returns 0 if all tasks succeeded, 1 otherwise
+int executeTaskrun(char commandLineBuffer[COMMAND_LINE_MAX_LENGTH], struct BackgroundProcessList *backgroundProcessList){
+    int maxRunning = 1;
+    BOOL shouldSkipUpToDate = FALSE;
+    //skip over 'taskrun'
+    char *cursor = &commandLineBuffer[strlen("taskrun")];
+    char word[COMMAND_LINE_MAX_LENGTH];
+    char taskFilePath[COMMAND_LINE_MAX_LENGTH];
+    taskFilePath[0] = '\0';
+    struct TaskGraph graph;
+    bzero(&graph, sizeof(graph));
+    //task names given after the task file are kept until the file has been read
+    char *targetsStart = NULL;
+    while(targetsStart == NULL && readNextWord(&cursor, word) == TRUE){
+        if(strcmp(word, "-j") == 0){
+            if(readNextWord(&cursor, word) == FALSE || (maxRunning = atoi(word)) < 1){
+                return printTaskrunUsage();
+            }
+        }
+        else if(strncmp(word, "-j", 2) == 0 && (maxRunning = atoi(&word[2])) >= 1){
+            continue;
+        }
+        else if(strcmp(word, "-u") == 0){
+            shouldSkipUpToDate = TRUE;
+        }
+        else if(word[0] == '-'){
+            return printTaskrunUsage();
+        }
+        else{
+            strcpy(taskFilePath, word);
+            targetsStart = cursor;
+        }
+    }
+    if(taskFilePath[0] == '\0'){
+        return printTaskrunUsage();
+    }
+    if(readTaskFile(taskFilePath, &graph) == FALSE){
+        destroyTaskGraph(&graph);
+        return 1;
+    }
+    //select tasks to run - all of them if none are given
+    int i;
+    cursor = targetsStart;
+    BOOL hasTargets = FALSE;
+    while(readNextWord(&cursor, word) == TRUE){
+        int taskIndex = findTask(&graph, word);
+        if(taskIndex == -1){
+            printf("taskrun: no task named %s\n", word);
+            destroyTaskGraph(&graph);
+            return 1;
+        }
+        selectTask(&graph, taskIndex);
+        hasTargets = TRUE;
+    }
+    int selectedCount = 0;
+    for(i = 0; i < graph.taskCount; ++i){
+        struct Task *task = &graph.tasks[i];
+        if(hasTargets == FALSE){
+            task->isSelected = TRUE;
+        }
+        if(task->isSelected == TRUE){
+            selectedCount++;
+        }
+        task->remainingDependencyCount = task->dependencyCount;
+        task->state = task->dependencyCount == 0 ? TASK_READY : TASK_WAITING;
+    }
+
+    struct timespec runStart;
+    getMonotonicTime(&runStart);
+    int runningCount = 0;
+    BOOL isInterrupted = FALSE;
+    interruptReceived = 0;
+    while(1){
+        //start ready tasks, in file order, while there is room
+        for(i = 0; i < graph.taskCount && runningCount < maxRunning && isInterrupted == FALSE; ++i){
+            struct Task *task = &graph.tasks[i];
+            if(task->isSelected == FALSE || task->state != TASK_READY){
+                continue;
+            }
+            task->startMicroseconds = getElapsedMicroseconds(&runStart);
+            if(shouldSkipUpToDate == TRUE && isTaskUpToDate(&graph, task)){
+                printf("task %s is up to date\n", task->name);
+                finishTask(&graph, task, TASK_UP_TO_DATE, task->startMicroseconds);
+                //dependents may have become ready, so check from the start again
+                i = -1;
+                continue;
+            }
+            if(task->commandLineBuffer[0] == '\0'){
+                finishTask(&graph, task, TASK_SUCCEEDED, task->startMicroseconds);
+                i = -1;
+                continue;
+            }
+            //spawnCommand() changes the command line while parsing it, so give it a copy
+            char taskCommandBuffer[COMMAND_LINE_MAX_LENGTH];
+            strcpy(taskCommandBuffer, task->commandLineBuffer);
+            //'&' doesn't mean anything in a task, since all tasks run alongside the shell
+            shouldExecuteInBackground(taskCommandBuffer, strlen(taskCommandBuffer));
+            fflush(stdout);
+            task->processId = spawnCommand(taskCommandBuffer, strlen(taskCommandBuffer), FALSE, FALSE, -1);
+            if(task->processId == -1){
+                printf("task %s failed: could not create new process\n", task->name);
+                task->status = 1 << 8;
+                finishTask(&graph, task, TASK_FAILED, task->startMicroseconds);
+                continue;
+            }
+            task->state = TASK_RUNNING;
+            runningCount++;
+        }
+        if(runningCount == 0){
+            break;
+        }
+        waitForShellEvent(-1, -1, backgroundProcessList);
+        //stop starting tasks once interrupted, and pass the interrupt on in case running tasks didn't get it from the terminal
+        if(interruptReceived && isInterrupted == FALSE){
+            isInterrupted = TRUE;
+            for(i = 0; i < graph.taskCount; ++i){
+                if(graph.tasks[i].state == TASK_RUNNING){
+                    kill(graph.tasks[i].processId, SIGINT);
+                }
+            }
+        }
+        for(i = 0; i < graph.taskCount; ++i){
+            struct Task *task = &graph.tasks[i];
+            if(task->state != TASK_RUNNING || reapChild(task->processId, &task->status, NULL) == FALSE){
+                continue;
+            }
+            runningCount--;
+            uint64_t endMicroseconds = getElapsedMicroseconds(&runStart);
+            //add to the statistics as if the command had been run on its own
+            struct timespec taskStart;
+            struct timespec taskOffset = {task->startMicroseconds / 1000000, (task->startMicroseconds % 1000000) * 1000};
+            addTimespec(&runStart, &taskOffset, &taskStart);
+            recordCommandStats(getCommandStatsForLine(task->commandLineBuffer), task->status, &taskStart);
+            char duration[32];
+            formatMicroseconds(endMicroseconds - task->startMicroseconds, duration);
+            if(WIFEXITED(task->status) && WEXITSTATUS(task->status) == 0){
+                printf("task %s done (%s)\n", task->name, duration);
+                finishTask(&graph, task, TASK_SUCCEEDED, endMicroseconds);
+            }
+            else{
+                if(WIFEXITED(task->status)){
+                    printf("task %s failed: exit value %d (%s)\n", task->name, WEXITSTATUS(task->status), duration);
+                }
+                else if(task->status == LOST_PROCESS_STATUS){
+                    printf("task %s failed: exit value unknown (%s)\n", task->name, duration);
+                }
+                else{
+                    printf("task %s failed: terminated by signal %d (%s)\n", task->name, WTERMSIG(task->status), duration);
+                }
+                finishTask(&graph, task, TASK_FAILED, endMicroseconds);
+            }
+        }
+    }
+
+    //summarize run
+    int counts[TASK_UP_TO_DATE + 1];
+    bzero(counts, sizeof(counts));
+    for(i = 0; i < graph.taskCount; ++i){
+        if(graph.tasks[i].isSelected == TRUE){
+            counts[graph.tasks[i].state]++;
+        }
+    }
+    char formatted[32];
+    formatMicroseconds(getElapsedMicroseconds(&runStart), formatted);
+    printf("%d tasks in %s: %d succeeded, %d failed, %d skipped, %d up to date", selectedCount, formatted, counts[TASK_SUCCEEDED], counts[TASK_FAILED], counts[TASK_SKIPPED], counts[TASK_UP_TO_DATE]);
+    //tasks still waiting were either part of a cycle or interrupted
+    int notRunCount = counts[TASK_WAITING] + counts[TASK_READY];
+    if(notRunCount > 0){
+        printf(", %d not run%s", notRunCount, isInterrupted == TRUE ? " (interrupted)" : " (dependency cycle)");
+    }
+    printf("\n");
+    printCriticalPath(&graph);
+    destroyTaskGraph(&graph);
+    return counts[TASK_SUCCEEDED] + counts[TASK_UP_TO_DATE] == selectedCount ? 0 : 1;
+}
+
+
+/*************************************
+* 'joblog' functions
+**************************************/
+
+//returns log of the most recent job with pid, or NULL if there isn't one
+//(pids can be reused, so older logs may have the same one)
+struct JobLog * findJobLog(pid_t pid){
+    struct JobLog *found = NULL;
+    struct JobLog *log;
+    for(log = jobLogs.head; log != NULL; log = log->next){
+        if(log->processId == pid){
+            found = log;
+        }
+    }
+    return found;
+}
+
+//prints output of log from offset up to what has been captured so far
+//returns offset of the end of what was printed
+uint64_t printJobLog(struct JobLog *log, uint64_t offset){
+    char buffer[INPUT_BUFFER_SIZE];
+    size_t readCount;
+    while((readCount = readJobLog(log, offset, buffer, sizeof(buffer))) > 0){
+        fwrite(buffer, 1, readCount, stdout);
+        offset += readCount;
+    }
+    fflush(stdout);
+    return offset;
+}
+
+//returns offset where the last lineCount lines of output of log start
+uint64_t findJobLogTail(struct JobLog *log, int lineCount){
+    uint64_t end = log->totalBytes;
+    if(lineCount <= 0){
+        return end;
+    }
+    char buffer[INPUT_BUFFER_SIZE];
+    uint64_t offset = end;
+    //read backwards a buffer at a time, counting newlines
+    while(offset > 0){
+        size_t length = offset < sizeof(buffer) ? offset : sizeof(buffer);
+        offset -= length;
+        readJobLog(log, offset, buffer, length);
+        int i;
+        for(i = length - 1; i >= 0; --i){
+            //newline at the very end finishes the last line rather than starting a new one
+            if(buffer[i] == '\n' && offset + i != end - 1 && --lineCount == 0){
+                return offset + i + 1;
+            }
+        }
+    }
+    return 0;
+}
+
+//prints every captured log, and how much memory they are using
+void printJobLogList(){
+    printf("capture is %s, %lu of %lu bytes of memory used\n", jobLogs.isCapturing == TRUE ? "on" : "off", (unsigned long) jobLogs.ringMemory, (unsigned long) JOB_LOG_MEMORY_LIMIT);
+    struct JobLog *log;
+    for(log = jobLogs.head; log != NULL; log = log->next){
+        printf("%-8ld %-8s %10llu bytes %10llu on disk%s  %s\n", (long) log->processId, log->pipeFileDescriptor == -1 ? "done" : "running", (unsigned long long) log->totalBytes, (unsigned long long) log->spilledBytes, log->hasSpillError == TRUE ? " (incomplete)" : "", log->commandLine);
+    }
+}
+
+//prints how to use 'joblog'
+//returns 1, since it is only printed when 'joblog' is used incorrectly
+int printJobLogUsage(){
+    printf("usage: joblog [on|off]\n");
+    printf("       joblog PID [--tail LINES] [--follow]\n");
+    return 1;
+}
+
+//executes 'joblog' command in commandLineBuffer
+//'joblog on' captures the output and errors of background commands started afterwards, instead of discarding them,
+//'joblog off' stops capturing, and 'joblog' on its own lists the captured logs
+//'joblog PID' prints what the background command with PID has written - all of it, or the last --tail lines
+//with --follow, it keeps printing new output until the command (and everything it started) is done, or control-c
+//returns 0 if successful, 1 otherwise
+int executeJobLog(char commandLineBuffer[COMMAND_LINE_MAX_LENGTH], struct BackgroundProcessList *backgroundProcessList){
+    //skip over 'joblog'
+    char *cursor = &commandLineBuffer[strlen("joblog")];
+    char word[COMMAND_LINE_MAX_LENGTH];
+    if(readNextWord(&cursor, word) == FALSE){
+        printJobLogList();
+        return 0;
+    }
+    if(strcmp(word, "on") == 0 || strcmp(word, "off") == 0){
+        BOOL shouldCapture = strcmp(word, "on") == 0;
+        if(readNextWord(&cursor, word) == TRUE){
+            return printJobLogUsage();
+        }
+        if(jobLogs.epollFileDescriptor == -1){
+            jobLogs.epollFileDescriptor = epoll_create1(EPOLL_CLOEXEC);
+            if(jobLogs.epollFileDescriptor == -1){
+                printf("joblog: cannot capture output\n");
+                return 1;
+            }
+        }
+        jobLogs.isCapturing = shouldCapture;
+        return 0;
+    }
+    char *end;
+    pid_t pid = strtol(word, &end, 10);
+    if(*end != '\0' || pid <= 0){
+        return printJobLogUsage();
+    }
+    int tailLineCount = -1;
+    BOOL shouldFollow = FALSE;
+    while(readNextWord(&cursor, word) == TRUE){
+        if(strcmp(word, "--follow") == 0 || strcmp(word, "-f") == 0){
+            shouldFollow = TRUE;
+        }
+        else if(strcmp(word, "--tail") == 0 || strcmp(word, "-n") == 0){
+            if(readNextWord(&cursor, word) == FALSE || (tailLineCount = strtol(word, &end, 10)) < 0 || *end != '\0'){
+                return printJobLogUsage();
+            }
+        }
+        else{
+            return printJobLogUsage();
+        }
+    }
+    struct JobLog *log = findJobLog(pid);
+    if(log == NULL){
+        printf("joblog: no output captured for %ld\n", (long) pid);
+        return 1;
+    }
+    uint64_t offset = tailLineCount == -1 ? 0 : findJobLogTail(log, tailLineCount);
+    offset = printJobLog(log, offset);
+    interruptReceived = 0;
+    //look the log up again after each wait, since old logs are removed as new jobs finish
+    while(shouldFollow == TRUE && log != NULL && log->pipeFileDescriptor != -1 && !interruptReceived){
+        waitForShellEvent(-1, -1, backgroundProcessList);
+        log = findJobLog(pid);
+        if(log != NULL){
+            offset = printJobLog(log, offset);
+        }
+    }
+    if(log != NULL && log->hasSpillError == TRUE){
+        printf("joblog: some output of %ld could not be saved\n", (long) pid);
+    }
+    return 0;
+}
+
+
+/*************************************
+* 'admit' functions
+**************************************/
+
+//prints how to use 'admit'
+//returns 1, since it is only printed when 'admit' is used incorrectly
+int printAdmitUsage(){
+    printf("usage: admit [on|off] [--cpu PERCENT] [--memory PERCENT] [--io PERCENT] [--load LOAD] [--max-jobs JOBS] [--burst JOBS] [--interval DURATION]\n");
+    return 1;
+}
+
+//prints admission controller settings, current pressure, and how long queued commands have waited
+void printAdmissionStatus(){
+    char formatted[32];
+    printf("admission control is %s\n", admissionController.isEnabled == TRUE ? "on" : "off");
+    formatMicroseconds((uint64_t) admissionController.interval.tv_sec * 1000000 + admissionController.interval.tv_nsec / 1000, formatted);
+    printf("limits: cpu %.1f%% memory %.1f%% io %.1f%% load %.2f max-jobs %d, %d started every %s\n", admissionController.cpuLimit, admissionController.memoryLimit, admissionController.ioLimit, admissionController.loadLimit, admissionController.maxJobs, admissionController.burst, formatted);
+    struct Pressure pressure;
+    samplePressure(&pressure);
+    if(pressure.hasPressureStallInformation == TRUE){
+        printf("pressure: cpu %.1f%% memory %.1f%% io %.1f%% load %.2f\n", pressure.cpu, pressure.memory, pressure.io, pressure.load);
+    }
+    else{
+        printf("pressure: load %.2f (no /proc/pressure, so only load is used)\n", pressure.load);
+    }
+    if(admissionController.head != NULL){
+        formatMicroseconds(getElapsedMicroseconds(&admissionController.head->queuedAt), formatted);
+        printf("queue: %d waiting, oldest for %s\n", admissionController.queueLength, formatted);
+    }
+    else{
+        printf("queue: empty\n");
+    }
+    struct CommandStats *waitStats = admissionController.waitStats;
+    if(waitStats != NULL && waitStats->callCount > 0){
+        printf("waited: %ld of %ld queued commands started, p50 ", waitStats->callCount, admissionController.totalQueued);
+        formatMicroseconds(getLatencyPercentile(waitStats, 50), formatted);
+        printf("%s p90 ", formatted);
+        formatMicroseconds(getLatencyPercentile(waitStats, 90), formatted);
+        printf("%s p99 ", formatted);
+        formatMicroseconds(getLatencyPercentile(waitStats, 99), formatted);
+        printf("%s max ", formatted);
+        formatMicroseconds(waitStats->maxMicroseconds, formatted);
+        printf("%s\n", formatted);
+    }
+}
+
+//executes 'admit' command in commandLineBuffer
+//'admit on' queues background commands while pressure on the system is over the limits, and 'admit off' stops queuing
+//the limits can be changed with the options, where 0 means no limit
+//with no arguments, prints the settings, current pressure and queue
+//returns 0 if successful, 1 otherwise
+int executeAdmit(char commandLineBuffer[COMMAND_LINE_MAX_LENGTH], struct BackgroundProcessList *backgroundProcessList){
+    //skip over 'admit'
+    char *cursor = &commandLineBuffer[strlen("admit")];
+    char word[COMMAND_LINE_MAX_LENGTH];
+    char value[COMMAND_LINE_MAX_LENGTH];
+    //settings are only changed if they are all valid
+    struct AdmissionController settings = admissionController;
+    BOOL hasArguments = FALSE;
+    while(readNextWord(&cursor, word) == TRUE){
+        hasArguments = TRUE;
+        if(strcmp(word, "on") == 0 || strcmp(word, "off") == 0){
+            settings.isEnabled = strcmp(word, "on") == 0;
+            continue;
+        }
+        //value can be given as '--option=value' or '--option value'
+        char *equals = strchr(word, '=');
+        if(equals != NULL){
+            *equals = '\0';
+            strcpy(value, equals + 1);
+        }
+        else if(readNextWord(&cursor, value) == FALSE){
+            return printAdmitUsage();
+        }
+        char *end;
+        double number = strtod(value, &end);
+        BOOL isNumber = value[0] != '\0' && *end == '\0' && number >= 0;
+        if(strcmp(word, "--cpu") == 0 && isNumber){
+            settings.cpuLimit = number;
+        }
+        else if(strcmp(word, "--memory") == 0 && isNumber){
+            settings.memoryLimit = number;
+        }
+        else if(strcmp(word, "--io") == 0 && isNumber){
+            settings.ioLimit = number;
+        }
+        else if(strcmp(word, "--load") == 0 && isNumber){
+            settings.loadLimit = number;
+        }
+        else if(strcmp(word, "--max-jobs") == 0 && isNumber){
+            settings.maxJobs = number;
+        }
+        else if(strcmp(word, "--burst") == 0 && isNumber && number >= 1){
+            settings.burst = number;
+        }
+        else if(strcmp(word, "--interval") == 0 && parseDuration(value, &settings.interval) == TRUE && !isTimespecZero(&settings.interval)){
+            continue;
+        }
+        else{
+            return printAdmitUsage();
+        }
+    }
+    if(hasArguments == FALSE){
+        printAdmissionStatus();
+        return 0;
+    }
+    admissionController = settings;
+    //sample pressure again with the new limits, and start whatever queued commands they now allow
+    //(all of them, if admission control was turned off)
+    getMonotonicTime(&admissionController.intervalStart);
+    admissionController.admittedCount = 0;
+    samplePressure(&admissionController.pressure);
+    updateAdmissionTimer();
+    startQueuedCommands(backgroundProcessList);
+    return 0;
+}
+
+//throws away background commands that are still queued
+//called before program exits
+void discardQueuedCommands(){
+    if(admissionController.queueLength > 0){
+        printf("%d queued background commands were not started\n", admissionController.queueLength);
+    }
+    while(admissionController.head != NULL){
+        destroyQueuedCommand(dequeueCommand());
+    }
+}
+
+
+//kill all background processes
+//and free memory from background process list
+//called before program exits
+void cleanUpBackgroundProcesses(struct BackgroundProcessList *backgroundProcessList){
+    struct BackgroundProcessNode *node = backgroundProcessList->head;
+    //initialize variable for status information in waitpid
+    int status = 0;
+    //iterate through all background processes, stopping them and freeing memory from the list
+    while(node != NULL){
+        //kill background process if still running
+        //based on: http://stackoverflow.com/questions/6501522/how-to-kill-a-child-process-by-the-parent-process
+        if(reapBackgroundProcess(node, backgroundProcessList, &status) == FALSE){
+            //send kill signal
+            signalJob(node->processId, node->isProcessGroup, SIGKILL);
+        }
+        //it finished on its own, so its line can still complete
+        else{
+            releaseJournalLine(node->journalLine);
+        }
+
+        //duplicate node, so we can store pointer to next node
+        //before deleting current node
+        struct BackgroundProcessNode *garbage = node;
+        node = node->next;
+        //free memory for current node
+        removeFromBackgroundProcessList(garbage, backgroundProcessList);
+    }
+}
+
+/*************************************
+* Server mode functions
+**************************************/
+
+//request sent to a server: this header followed by the command line, in one
+//SOCK_SEQPACKET message with the client's standard input, output and error attached
+struct ServerRequestHeader{
+    //chosen by the client and returned in the response, so requests can be pipelined
+    uint32_t requestId;
+};
+
+//response sent by a server when a command finishes
+struct ServerResponse{
+    uint32_t requestId;
+    //status from waitpid, so clients can use WIFEXITED() and friends
+    int32_t waitStatus;
+    //time from fork() to being reaped
+    int64_t wallMicroseconds;
+    //resource usage from wait4()
+    int64_t userMicroseconds;
+    int64_t systemMicroseconds;
+    int64_t maxResidentKilobytes;
+};
+
+//number of file descriptors sent with a request - standard input, output and error
+#define SERVER_FILE_DESCRIPTOR_COUNT 3
+//size of the largest request message
+#define SERVER_REQUEST_MAX_SIZE (sizeof(struct ServerRequestHeader) + COMMAND_LINE_MAX_LENGTH)
+//most requests waiting to run for one client, and for all clients
+//each one holds its client's file descriptors, so without a limit clients could use up all of the server's
+#define SERVER_MAX_CLIENT_QUEUED_JOBS 64
+#define SERVER_MAX_QUEUED_JOBS 256
+
+//connected client and the accounting for its requests
+struct ServerClient{
+    int socket;
+    //number assigned when the client connected, used in log messages
+    unsigned long clientNumber;
+    BOOL isConnected;
+    //commands running and waiting to run for this client
+    int runningCount;
+    int queuedCount;
+    unsigned long requestCount;
+    unsigned long failedCount;
+    int64_t userMicroseconds;
+    int64_t systemMicroseconds;
+    struct ServerClient *next;
+};
+
+//command received by the server, either waiting to run or running
+struct ServerJob{
+    struct ServerClient *client;
+    uint32_t requestId;
+    char commandLineBuffer[COMMAND_LINE_MAX_LENGTH];
+    //client's standard input, output and error
+    int fileDescriptors[SERVER_FILE_DESCRIPTOR_COUNT];
+    pid_t processId;
+    struct timespec startTime;
+    struct ServerJob *next;
+};
+
+//state of server started with --server
+struct Server{
+    int listenSocket;
+    const char *socketPath;
+    //limit on commands running at once, for all clients and for each client
+    int maxJobs;
+    int maxClientJobs;
+    int runningCount;
+    unsigned long clientCount;
+    struct ServerClient *clients;
+    //jobs waiting for a free slot, in the order received
+    int queuedCount;
+    struct ServerJob *queueHead;
+    struct ServerJob *queueTail;
+    struct ServerJob *runningJobs;
+};
+
+//set by signal handler when server should shut down
+volatile sig_atomic_t serverShouldStop = 0;
+
+//handles SIGINT and SIGTERM in server mode by asking the main loop to shut down
+void serverStopHandler(int signalNum){
+    serverShouldStop = 1;
+}
+
+//returns microseconds in a timeval, used for rusage times
+int64_t timevalToMicroseconds(const struct timeval *time){
+    return (int64_t) time->tv_sec * 1000000 + time->tv_usec;
+}
+
+//closes the file descriptors of a job and frees it
+void destroyServerJob(struct ServerJob *job){
+    int i;
+    for(i = 0; i < SERVER_FILE_DESCRIPTOR_COUNT; ++i){
+        if(job->fileDescriptors[i] != -1){
+            close(job->fileDescriptors[i]);
         }
-        i++;
     }
-    //if we're here there is no output redirection (or redirection symbol but no filename), so return NULL
-    return NULL;
+    free(job);
 }
 
-//free space allocated for arguments in commandArguments array
-void destroyCommandArguments(char *commandArguments[MAX_ARGUMENT_COUNT + 1], int argumentCount){
-    //initialize variables to hold current array index and current argument to be freed
-    int i = 0;
-    char *currentArgument;
-    //free all arguments until we reach null or we have gone past end of array
-    while(i < argumentCount && (currentArgument = commandArguments[i]) != NULL ){
-        //free memory
-        free(currentArgument);
-        i++;
+//frees client once it has disconnected and has nothing left running
+//prints the client's accounting
+void releaseServerClient(struct Server *server, struct ServerClient *client){
+    if(client->isConnected == TRUE || client->runningCount > 0 || client->queuedCount > 0){
+        return;
     }
+    printf("client %lu done: %lu requests, %lu failed, user %.3fs, system %.3fs\n", client->clientNumber, client->requestCount, client->failedCount, client->userMicroseconds / 1000000.0, client->systemMicroseconds / 1000000.0);
+    fflush(stdout);
+    struct ServerClient **link = &server->clients;
+    while(*link != client){
+        link = &(*link)->next;
+    }
+    *link = client->next;
+    free(client);
 }
 
-//takes command in commandLineBuffer and modifies it in-place to expand
-//$$ in the command to the current process id 
-void expandVariables(char commandLineBuffer[COMMAND_LINE_MAX_LENGTH], int bufferLength){
-    //create empty string to store commandLineBuffer with expanded pid
-    char commandLineBufferExpanded[COMMAND_LINE_MAX_LENGTH];
-    //initialize with null chars
-    bzero(commandLineBufferExpanded, COMMAND_LINE_MAX_LENGTH);
-    //initialize variables to store the index in the array for the source and destination index
-    int sourceIndex;
-    //need separate index for the destination string because as we expand $$, it will be potentially be
-    //longer than the source, and thus the indexes will be out of sync
-    int destIndex = 0;
-    //keep track if previous character was a dollar sign, because if we then see a second one we know to expand
-    BOOL previousCharWasDollarSign = FALSE;
-    //convert pid to string
-    //based on: http://stackoverflow.com/questions/15262315/how-to-convert-pid-t-to-string
-    char pidString[COMMAND_LINE_MAX_LENGTH];
-    sprintf(pidString, "%ld", (long)getpid());
-    int pidStringLength = strlen(pidString);
+//sends result of finished job to its client, adds it to the client's accounting, and frees it
+//status is the job's waitpid status and usage its resource usage
+void finishServerJob(struct Server *server, struct ServerJob *job, int status, const struct rusage *usage){
+    struct ServerClient *client = job->client;
+    struct ServerResponse response;
+    response.requestId = job->requestId;
+    response.waitStatus = status;
+    response.wallMicroseconds = getElapsedMicroseconds(&job->startTime);
+    response.userMicroseconds = timevalToMicroseconds(&usage->ru_utime);
+    response.systemMicroseconds = timevalToMicroseconds(&usage->ru_stime);
+    response.maxResidentKilobytes = usage->ru_maxrss;
+    if(status != 0){
+        client->failedCount++;
+    }
+    client->userMicroseconds += response.userMicroseconds;
+    client->systemMicroseconds += response.systemMicroseconds;
+    if(client->isConnected == TRUE){
+        sendWithFileDescriptors(client->socket, &response, sizeof(response), NULL, 0);
+    }
+    destroyServerJob(job);
+    releaseServerClient(server, client);
+}
 
-    //copy all the chars from commandLineBuffer into expanded version, while checking for $$ and expanding it to pid
-    for(sourceIndex = 0; sourceIndex < bufferLength && destIndex < COMMAND_LINE_MAX_LENGTH - 1; ++sourceIndex){
-        char currentChar = commandLineBuffer[sourceIndex];
-        //if the current character is '$' and the previous character was '$', we know we need to expand it
-        if(currentChar == '$' && previousCharWasDollarSign == TRUE){
-            //we need to erase the previous dollar sign, so back to previous index
-            destIndex--;
-            int pidStringIndex;
-            //copy pid string to expanded variables, overwriting the previous $ that we have already written
-            for(pidStringIndex = 0; pidStringIndex < pidStringLength; ++pidStringIndex){
-                char pidChar = pidString[pidStringIndex];
-                commandLineBufferExpanded[destIndex] = pidChar;
-                //increase destination index, since we added a character
-                destIndex++;
-            }
-            //reset if previous char was dollar sign, because we need to be able to expand
-            //$$$$ to pidpid
-            previousCharWasDollarSign = FALSE;
-        }
-        //no consecutive dollar sign, so no expanding variables
-        else{
-            //see if we are seeing dollar sign for the first time
-            if(currentChar == '$'){
-                previousCharWasDollarSign = TRUE;
-            }
-            //otherwise reset it
-            else{
-                previousCharWasDollarSign = FALSE;
+//forks a process to run job through the usual parse, redirect and exec functions,
+//with the client's file descriptors as its standard input, output and error
+//the job leads its own process group, so anything it starts can be stopped along with it when the server shuts down
+void startServerJob(struct Server *server, struct ServerJob *job){
+    getMonotonicTime(&job->startTime);
+    job->processId = fork();
+    if(job->processId == 0){
+        setpgid(0, 0);
+        //restore signals the server changed, since ignored signals stay ignored after exec
+        signal(SIGPIPE, SIG_DFL);
+        signal(SIGINT, SIG_DFL);
+        signal(SIGTERM, SIG_DFL);
+        //never run the command with the server's own standard streams
+        int i;
+        for(i = 0; i < SERVER_FILE_DESCRIPTOR_COUNT; ++i){
+            if(job->fileDescriptors[i] == -1 || dup2(job->fileDescriptors[i], i) == -1){
+                exit(1);
             }
-            //no variables to expand, so simply copy current character
-            //and increment the destination index, since we have written in it
-            commandLineBufferExpanded[destIndex] = currentChar;
-            destIndex++;
         }
+        //'&' doesn't mean anything here, since the client is sent the result whenever the command finishes
+        int bufferLength = strlen(job->commandLineBuffer);
+        shouldExecuteInBackground(job->commandLineBuffer, bufferLength);
+        childProcessExecuteCommand(job->commandLineBuffer, strlen(job->commandLineBuffer), FALSE, FALSE, -1);
     }
-    //overwrite commandLineBuffer with expanded version
-    //if the expanded version ends up being longer than the max length it will be truncated
-    strncpy(commandLineBuffer, commandLineBufferExpanded, COMMAND_LINE_MAX_LENGTH);
+    //report process that couldn't be created as exiting with 1, like executeCommand() does
+    if(job->processId == -1){
+        struct rusage usage;
+        bzero(&usage, sizeof(usage));
+        finishServerJob(server, job, 1 << 8, &usage);
+        return;
+    }
+    //set it here too, so the group exists before the server signals it, no matter which process runs first
+    setpgid(job->processId, job->processId);
+    job->client->runningCount++;
+    server->runningCount++;
+    job->next = server->runningJobs;
+    server->runningJobs = job;
 }
 
-
-/////////////////////////////////////////////////////
-// Parse for command for background process and input
-//output redirection
-/////////////////////////////////////////////////////
-
-//determines if command ends with '&' so that command should run in background
-//also erases ending '&' if there is one with null chars so it will not be executed
-BOOL shouldExecuteInBackground(char commandLineBuffer[COMMAND_LINE_MAX_LENGTH], int bufferLength){
-    int i;
-    //start at end of command, ignoring whitespace to find first non-whitespace character
-    //if that character is '&' delete it and return true, otherwise return false
-    for (i = bufferLength -1; i >= 0; --i){
-        //ignore trailing whitespace
-        if(isspace(commandLineBuffer[i])){
+//starts queued jobs, in the order they were received, while there are free slots
+//jobs of clients that have reached their own limit wait without holding up other clients
+void startQueuedServerJobs(struct Server *server){
+    struct ServerJob **link = &server->queueHead;
+    struct ServerJob *previous = NULL;
+    while(*link != NULL && server->runningCount < server->maxJobs){
+        struct ServerJob *job = *link;
+        if(job->client->runningCount >= server->maxClientJobs){
+            previous = job;
+            link = &job->next;
             continue;
         }
-        //'&' found at end of the string
-        if(commandLineBuffer[i] == '&'){
-            //erase character from string
-            commandLineBuffer[i] = '\0';
-            return TRUE;
-        }
-        //first non-whitespace character was found and it is not '&'
-        else{
-            break;
+        *link = job->next;
+        if(server->queueTail == job){
+            server->queueTail = previous;
         }
+        job->client->queuedCount--;
+        server->queuedCount--;
+        startServerJob(server, job);
     }
-    //'&' not found
-    return FALSE;
 }
 
+//reaps finished jobs and sends their results to their clients
+void reapServerJobs(struct Server *server){
+    struct ServerJob **link = &server->runningJobs;
+    while(*link != NULL){
+        struct ServerJob *job = *link;
+        int status = 0;
+        struct rusage usage;
+        if(reapChild(job->processId, &status, &usage) == FALSE){
+            link = &job->next;
+            continue;
+        }
+        *link = job->next;
+        job->client->runningCount--;
+        server->runningCount--;
+        finishServerJob(server, job, status, &usage);
+    }
+}
 
+//fails job without running it, telling the client why on its standard error
+//the client gets an exit value of 1, like a command that couldn't be started
+void refuseServerJob(struct Server *server, struct ServerJob *job, const char *reason){
+    if(job->fileDescriptors[2] != -1){
+        dprintf(job->fileDescriptors[2], "smallsh: %s\n", reason);
+    }
+    struct rusage usage;
+    bzero(&usage, sizeof(usage));
+    finishServerJob(server, job, 1 << 8, &usage);
+}
 
-///////////////////////////////////////////////////
-// Child and parent process functions
-//////////////////////////////////////////////////
-
-//used in child process to redirect output
-void redirectOutput(char *commandArguments[MAX_ARGUMENT_COUNT + 1], BOOL isBackgroundCommand){
-    //get output redirection if there is any
-    char *outputFileName = parseRedirection(commandArguments, ">");
-    //need to keep track if outputFileName is allocated, so we know if we have to free it
-    //won't be allocated if we manually set to /dev/null
-    BOOL isOutputFileNameAllocated = TRUE;
-    //background commands with no output redirection get sent to /dev/null
-    //based on: http://stackoverflow.com/questions/14846768/in-c-how-do-i-redirect-stdout-fileno-to-dev-null-using-dup2-and-then-redirect
-    if(outputFileName == NULL && isBackgroundCommand == TRUE){
-        outputFileName = "/dev/null";
-        //set flag to false, so we don't try to free this later
-        isOutputFileNameAllocated = FALSE;
+//reads one request from client and queues it
+//requests are refused once too many are waiting, or if their standard streams can't be opened
+//disconnects client if it has closed its socket or sent something invalid, or its file descriptors couldn't all be received
+void receiveServerRequest(struct Server *server, struct ServerClient *client){
+    char message[SERVER_REQUEST_MAX_SIZE];
+    int fileDescriptors[SERVER_FILE_DESCRIPTOR_COUNT];
+    int fileDescriptorCount;
+    ssize_t bytesReceived = receiveWithFileDescriptors(client->socket, message, sizeof(message), fileDescriptors, SERVER_FILE_DESCRIPTOR_COUNT, &fileDescriptorCount);
+    if(bytesReceived == -1 && (errno == EAGAIN || errno == EWOULDBLOCK)){
+        return;
     }
-    
-    //check for output redirection
-    if(outputFileName != NULL){
-        //based on Lecture 12 slides
-        //attempt to redirect standard output to filename
-        int fileDescriptor = open(outputFileName, O_WRONLY|O_CREAT|O_TRUNC, 0644);
-        //check that we were able to open the file
-        //-1 means there was an error trying to do this
-        if(fileDescriptor == -1){
-            printf("cannot open %s for output\n", outputFileName);
-            exit(1);
+    if(bytesReceived < (ssize_t) sizeof(struct ServerRequestHeader)){
+        int i;
+        for(i = 0; i < fileDescriptorCount; ++i){
+            close(fileDescriptors[i]);
         }
-        //redirect standard output '1' to the file we just opened
-        fileDescriptor = dup2(fileDescriptor, 1);
-        //check again for errors
-        if(fileDescriptor == -1){
-            printf("error redirecting standard output to %s\n", outputFileName);
-            exit(1);
+        //drop jobs that haven't started yet, since no one is waiting for them
+        struct ServerJob **link = &server->queueHead;
+        struct ServerJob *previous = NULL;
+        while(*link != NULL){
+            struct ServerJob *job = *link;
+            if(job->client != client){
+                previous = job;
+                link = &job->next;
+                continue;
+            }
+            *link = job->next;
+            if(server->queueTail == job){
+                server->queueTail = previous;
+            }
+            client->queuedCount--;
+            server->queuedCount--;
+            destroyServerJob(job);
         }
+        close(client->socket);
+        client->isConnected = FALSE;
+        releaseServerClient(server, client);
+        return;
     }
-    //free outputFileName, if it was allocated
-    //need to check if null and allocated because if we manually set it to "/dev/null"
-    //it won't be allocated, or if no redirection was given it won't be allocated
-    //since we don't need it anymore
-    if(outputFileName != NULL && isOutputFileNameAllocated == TRUE){
-        free(outputFileName);
+    struct ServerJob *job = malloc(sizeof(struct ServerJob));
+    assert(job != NULL);
+    struct ServerRequestHeader header;
+    memcpy(&header, message, sizeof(header));
+    job->client = client;
+    job->requestId = header.requestId;
+    int commandLength = bytesReceived - sizeof(header);
+    if(commandLength > COMMAND_LINE_MAX_LENGTH - 1){
+        commandLength = COMMAND_LINE_MAX_LENGTH - 1;
+    }
+    memcpy(job->commandLineBuffer, &message[sizeof(header)], commandLength);
+    job->commandLineBuffer[commandLength] = '\0';
+    //use /dev/null for any standard streams the client didn't send
+    int i;
+    for(i = 0; i < SERVER_FILE_DESCRIPTOR_COUNT; ++i){
+        job->fileDescriptors[i] = i < fileDescriptorCount ? fileDescriptors[i] : open("/dev/null", i == 0 ? O_RDONLY | O_CLOEXEC : O_WRONLY | O_CLOEXEC);
+    }
+    job->processId = 0;
+    job->next = NULL;
+    client->requestCount++;
+    if(job->fileDescriptors[0] == -1 || job->fileDescriptors[1] == -1 || job->fileDescriptors[2] == -1){
+        refuseServerJob(server, job, "server could not open standard streams for the command");
+        return;
+    }
+    if(client->queuedCount >= SERVER_MAX_CLIENT_QUEUED_JOBS || server->queuedCount >= SERVER_MAX_QUEUED_JOBS){
+        refuseServerJob(server, job, "server is busy, too many commands are waiting to run");
+        return;
+    }
+    //each request is run as one process, so it can't be a list of commands
+    if(hasListOperator(job->commandLineBuffer) == TRUE){
+        refuseServerJob(server, job, "commands sent to a server can't contain ';', '&&', '||' or '&'");
+        return;
+    }
+    if(server->queueTail == NULL){
+        server->queueHead = job;
+    }
+    else{
+        server->queueTail->next = job;
     }
+    server->queueTail = job;
+    client->queuedCount++;
+    server->queuedCount++;
 }
 
-//used in child process to redirect standard input
-void redirectInput(char *commandArguments[MAX_ARGUMENT_COUNT + 1], BOOL isBackgroundCommand){
-    //get input redirection if there is any
-    char *inputFileName = parseRedirection(commandArguments, "<");
-    //need to keep track if inputFileName is allocated, so we know if we have to free it
-    //won't be allocated if we manually set to /dev/null
-    BOOL isInputFileNameAllocated = TRUE;
-    //background commands with no input redirection get sent to /dev/null
-    //based on: http://stackoverflow.com/questions/14846768/in-c-how-do-i-redirect-stdout-fileno-to-dev-null-using-dup2-and-then-redirect
-    if(inputFileName == NULL && isBackgroundCommand == TRUE){
-        inputFileName = "/dev/null";
-        //set flag to false, so we don't try to free this later
-        isInputFileNameAllocated = FALSE;
-    }
-    
-    //check for input redirection
-    if(inputFileName != NULL){
-        //based on Lecture 12 slides
-        //attempt to redirect standard input to filename
-        int fileDescriptor = open(inputFileName, O_RDONLY);
-        //check that we were able to open the file
-        //-1 means there was an error trying to do this
-        if(fileDescriptor == -1){
-            printf("cannot open %s for input\n", inputFileName);
-            exit(1);
+//accepts new client connections
+void acceptServerClients(struct Server *server){
+    while(1){
+        int clientSocket = accept4(server->listenSocket, NULL, NULL, SOCK_CLOEXEC | SOCK_NONBLOCK);
+        if(clientSocket == -1){
+            return;
         }
-        //redirect standard input '0' to the file we just opened
-        fileDescriptor = dup2(fileDescriptor, 0);
-        //check again for errors
-        if(fileDescriptor == -1){
-            printf("error redirecting standard input to %s\n", inputFileName);
-            exit(1);
+        //only run commands for the user running the server
+        struct ucred credentials;
+        socklen_t credentialsLength = sizeof(credentials);
+        if(getsockopt(clientSocket, SOL_SOCKET, SO_PEERCRED, &credentials, &credentialsLength) == -1 || credentials.uid != getuid()){
+            close(clientSocket);
+            continue;
         }
+        struct ServerClient *client = calloc(1, sizeof(struct ServerClient));
+        assert(client != NULL);
+        client->socket = clientSocket;
+        client->clientNumber = ++server->clientCount;
+        client->isConnected = TRUE;
+        client->next = server->clients;
+        server->clients = client;
     }
-    //free inputFileName, if it was allocated
-    //need to check if null and allocated because if we manually set it to "/dev/null"
-    //it won't be allocated, or if no redirection was given it won't be allocated
-    //since we don't need it anymore
-    if(inputFileName != NULL && isInputFileNameAllocated == TRUE){
-        free(inputFileName);
+}
+
+//opens socket at path for clients to connect to
+//returns socket, or -1 if it couldn't be created
+int openServerSocket(const char *path){
+    struct sockaddr_un address;
+    bzero(&address, sizeof(address));
+    address.sun_family = AF_UNIX;
+    if(strlen(path) >= sizeof(address.sun_path)){
+        printf("socket path %s is too long\n", path);
+        return -1;
+    }
+    strcpy(address.sun_path, path);
+    int listenSocket = socket(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC | SOCK_NONBLOCK, 0);
+    if(listenSocket == -1){
+        printf("could not create socket\n");
+        return -1;
+    }
+    //remove socket left over from a previous server, but never anything else that happens to be at path
+    struct stat pathStat;
+    if(lstat(path, &pathStat) == 0){
+        if(!S_ISSOCK(pathStat.st_mode)){
+            printf("%s already exists and is not a socket\n", path);
+            close(listenSocket);
+            return -1;
+        }
+        unlink(path);
+    }
+    //socket is only usable by its owner, and created that way so there is no window where others can connect
+    mode_t previousMask = umask(0077);
+    int bindResult = bind(listenSocket, (struct sockaddr *) &address, sizeof(address));
+    umask(previousMask);
+    if(bindResult == -1 || chmod(path, 0600) == -1 || listen(listenSocket, SOMAXCONN) == -1){
+        printf("could not listen on %s\n", path);
+        close(listenSocket);
+        return -1;
     }
+    return listenSocket;
 }
 
-//prints error status if command fails, and is not a background command
-void printExecutionError(int errorCode, char *commandName, BOOL isBackgroundCommand){
-    //don't printout errors for background commands
-    if(isBackgroundCommand == TRUE){
-        return;
+//connects to server socket at path
+//returns socket, or -1 if connection failed
+int connectToServer(const char *path){
+    struct sockaddr_un address;
+    bzero(&address, sizeof(address));
+    address.sun_family = AF_UNIX;
+    strncpy(address.sun_path, path, sizeof(address.sun_path) - 1);
+    int serverSocket = socket(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0);
+    if(serverSocket == -1 || connect(serverSocket, (struct sockaddr *) &address, sizeof(address)) == -1){
+        printf("could not connect to %s\n", path);
+        if(serverSocket != -1){
+            close(serverSocket);
+        }
+        return -1;
     }
-    //print error based on errno
-    //based on: https://linux.die.net/man/2/execve
-    switch(errorCode){
-        //permissions error for command
-        case EACCES:
-            printf("%s: execute permission denied\n", commandName);
-            break;
-        //file doesn't exist
-        case ENOENT:
-            printf("%s: no such file or directory\n", commandName);
-            break;
-        //problem with the executable file
-        case ENOEXEC:
-            printf("%s: could not be executed\n", commandName);
-            break;
-        //unspecified error
-        default:
-            printf("There was an error with trying to run %s\n", commandName);
-            break;
+    return serverSocket;
+}
+
+//runs smallsh as a server executing command lines sent by clients on a unix socket at socketPath
+//at most maxJobs commands run at once, and at most maxClientJobs for any one client
+//runs until interrupted, and returns exit status for the program
+int runServer(const char *socketPath, int maxJobs, int maxClientJobs){
+    struct Server server;
+    bzero(&server, sizeof(server));
+    server.socketPath = socketPath;
+    server.maxJobs = maxJobs;
+    server.maxClientJobs = maxClientJobs;
+    server.listenSocket = openServerSocket(socketPath);
+    if(server.listenSocket == -1){
+        return 1;
+    }
+    //clients that disconnect shouldn't kill the server
+    signal(SIGPIPE, SIG_IGN);
+    struct sigaction act;
+    act.sa_handler = serverStopHandler;
+    act.sa_flags = 0;
+    sigfillset(&(act.sa_mask));
+    sigaction(SIGINT, &act, NULL);
+    sigaction(SIGTERM, &act, NULL);
+    printf("listening on %s (at most %d jobs, %d per client)\n", socketPath, maxJobs, maxClientJobs);
+    fflush(stdout);
+
+    struct pollfd *pollFileDescriptors = NULL;
+    int pollCapacity = 0;
+    while(serverShouldStop == 0){
+        //listen socket, child pipe, and a slot for each connected client
+        int clientCount = 0;
+        struct ServerClient *client;
+        for(client = server.clients; client != NULL; client = client->next){
+            clientCount++;
+        }
+        if(clientCount + 2 > pollCapacity){
+            pollCapacity = (clientCount + 2) * 2;
+            pollFileDescriptors = realloc(pollFileDescriptors, sizeof(struct pollfd) * pollCapacity);
+            assert(pollFileDescriptors != NULL);
+        }
+        int pollCount = 0;
+        pollFileDescriptors[pollCount].fd = server.listenSocket;
+        pollFileDescriptors[pollCount++].events = POLLIN;
+        pollFileDescriptors[pollCount].fd = signalEventPipe[0];
+        pollFileDescriptors[pollCount++].events = POLLIN;
+        for(client = server.clients; client != NULL; client = client->next){
+            //disconnected clients are only kept until their jobs finish
+            pollFileDescriptors[pollCount].fd = client->isConnected == TRUE ? client->socket : -1;
+            pollFileDescriptors[pollCount++].events = POLLIN;
+        }
+        if(poll(pollFileDescriptors, pollCount, -1) == -1){
+            continue;
+        }
+        if(pollFileDescriptors[1].revents != 0){
+            char notifications[64];
+            while(read(signalEventPipe[0], notifications, sizeof(notifications)) > 0){
+            }
+            reapServerJobs(&server);
+        }
+        //read requests - clients are in the same order as when the poll list was built
+        //save next before receiving, since a client that disconnected may be freed
+        int pollIndex = 2;
+        struct ServerClient *nextClient;
+        for(client = server.clients; client != NULL && pollIndex < pollCount; client = nextClient, pollIndex++){
+            nextClient = client->next;
+            if(pollFileDescriptors[pollIndex].revents != 0){
+                receiveServerRequest(&server, client);
+            }
+        }
+        if(pollFileDescriptors[0].revents != 0){
+            acceptServerClients(&server);
+        }
+        startQueuedServerJobs(&server);
     }
 
+    //shut down - stop running jobs and everything they started, and wait for them, so no processes are left behind
+    struct ServerJob *job;
+    for(job = server.runningJobs; job != NULL; job = job->next){
+        kill(-job->processId, SIGTERM);
+    }
+    for(job = server.runningJobs; job != NULL; job = job->next){
+        waitpid(job->processId, NULL, 0);
+    }
+    close(server.listenSocket);
+    unlink(socketPath);
+    free(pollFileDescriptors);
+    return 0;
 }
 
-//Executes parses command in commandLineBuffer and executes in foreground for child process
-void childProcessExecuteCommand(char commandLineBuffer[COMMAND_LINE_MAX_LENGTH], int bufferLength, BOOL isBackgroundCommand){
-    //expand all '$$'' to pid in commandLineBuffec
-    expandVariables(commandLineBuffer, bufferLength);
-
-    //initialize variable to store commands in commandLineBuffer parsed into array
-    //need space for 1 more than max arguments because we need to store NULL at the end
-    char *commandArguments[MAX_ARGUMENT_COUNT + 1];
-    int argumentCount = parseCommandArguments(commandLineBuffer, commandArguments);
-    //only run command if there is a command to be run
-    if(argumentCount < 1){
-        //no commands (commandLineBuffer was empty of just whitespace), so exit early
-        exit(0);
+//sends command to server, along with this process's standard input, output and error
+//and waits for it to finish
+//returns exit value of command, or 128 plus the signal number if it was terminated by a signal, like other shells
+int runClient(const char *socketPath, const char *command){
+    int serverSocket = connectToServer(socketPath);
+    if(serverSocket == -1){
+        return 1;
     }
-    //save standard output, since we will need to restore it later if there is an error
-    //with a command that redirects output
-    //based on: http://stackoverflow.com/questions/11042218/c-restore-stdout-to-terminal
-    int standardOutputFileDescriptor = dup(1);
-    //redirect standard output as necessary
-    redirectOutput(commandArguments, isBackgroundCommand);
-    //redirect standard input as necessary
-    redirectInput(commandArguments, isBackgroundCommand);
+    char message[SERVER_REQUEST_MAX_SIZE];
+    struct ServerRequestHeader header;
+    header.requestId = 0;
+    memcpy(message, &header, sizeof(header));
+    int commandLength = strlen(command);
+    memcpy(&message[sizeof(header)], command, commandLength);
+    int standardFileDescriptors[SERVER_FILE_DESCRIPTOR_COUNT] = {STDIN_FILENO, STDOUT_FILENO, STDERR_FILENO};
+    struct ServerResponse response;
+    int fileDescriptorCount;
+    if(sendWithFileDescriptors(serverSocket, message, sizeof(header) + commandLength, standardFileDescriptors, SERVER_FILE_DESCRIPTOR_COUNT) == FALSE
+        || receiveWithFileDescriptors(serverSocket, &response, sizeof(response), NULL, 0, &fileDescriptorCount) != sizeof(response)){
+        printf("lost connection to %s\n", socketPath);
+        close(serverSocket);
+        return 1;
+    }
+    close(serverSocket);
+    if(WIFSIGNALED(response.waitStatus)){
+        return 128 + WTERMSIG(response.waitStatus);
+    }
+    return WEXITSTATUS(response.waitStatus);
+}
 
-    //first item is commandArguments is program name, and we need to pass it again in the arguments
-    int status = execvp(commandArguments[0], commandArguments);
-    //check for error and normalize status to be either 1 for error
-    //or 0 for finished successfully
-    if(status == -1){
-        status = 1;
-        //restore standard output, so we can print error message
-        dup2(standardOutputFileDescriptor, 1);
-        //error status stored in errno, so printout message based on this if not background command
-        //(we have already checked that commandArguments has at least length one, so no need to check first)
-        printExecutionError(errno, commandArguments[0], isBackgroundCommand);
+//load generator for benchmarking a server
+//sends command requestCount times over connectionCount connections, each with one request in flight,
+//and prints requests per second and latency percentiles
+int runServerBenchmark(const char *socketPath, const char *command, int requestCount, int connectionCount){
+    int *sockets = malloc(sizeof(int) * connectionCount);
+    struct timespec *sentTimes = malloc(sizeof(struct timespec) * connectionCount);
+    struct pollfd *pollFileDescriptors = malloc(sizeof(struct pollfd) * connectionCount);
+    assert(sockets != NULL && sentTimes != NULL && pollFileDescriptors != NULL);
+    //commands' output is thrown away, so only the server is being measured
+    int nullFileDescriptor = open("/dev/null", O_RDWR | O_CLOEXEC);
+    int nullFileDescriptors[SERVER_FILE_DESCRIPTOR_COUNT] = {nullFileDescriptor, nullFileDescriptor, nullFileDescriptor};
+    char message[SERVER_REQUEST_MAX_SIZE];
+    int commandLength = strlen(command);
+    memcpy(&message[sizeof(struct ServerRequestHeader)], command, commandLength);
+    int messageLength = sizeof(struct ServerRequestHeader) + commandLength;
+    //latencies are kept in the same kind of histogram as the 'stats' command uses
+    struct CommandStats *latencyStats = calloc(1, sizeof(struct CommandStats));
+    assert(latencyStats != NULL);
+    int sentCount = 0;
+    int completedCount = 0;
+    int failedCount = 0;
+    struct timespec benchmarkStart;
+    getMonotonicTime(&benchmarkStart);
+    int i;
+    for(i = 0; i < connectionCount; ++i){
+        sockets[i] = connectToServer(socketPath);
+        if(sockets[i] == -1){
+            return 1;
+        }
+        pollFileDescriptors[i].fd = sockets[i];
+        pollFileDescriptors[i].events = POLLIN;
     }
-    else{
-        status = 0;
+    //start one request on each connection, then send another whenever one finishes
+    for(i = 0; i < connectionCount && sentCount < requestCount; ++i){
+        struct ServerRequestHeader header = {sentCount++};
+        memcpy(message, &header, sizeof(header));
+        getMonotonicTime(&sentTimes[i]);
+        sendWithFileDescriptors(sockets[i], message, messageLength, nullFileDescriptors, SERVER_FILE_DESCRIPTOR_COUNT);
     }
-    //free memory allocated for commandArguments
-    destroyCommandArguments(commandArguments, argumentCount);
-    //close process after exec completes
-    exit(status);
+    while(completedCount < sentCount){
+        if(poll(pollFileDescriptors, connectionCount, -1) == -1){
+            continue;
+        }
+        for(i = 0; i < connectionCount; ++i){
+            if(pollFileDescriptors[i].revents == 0){
+                continue;
+            }
+            struct ServerResponse response;
+            int fileDescriptorCount;
+            if(receiveWithFileDescriptors(sockets[i], &response, sizeof(response), NULL, 0, &fileDescriptorCount) != sizeof(response)){
+                printf("lost connection to %s\n", socketPath);
+                return 1;
+            }
+            completedCount++;
+            recordCommandStats(latencyStats, response.waitStatus, &sentTimes[i]);
+            if(response.waitStatus != 0){
+                failedCount++;
+            }
+            if(sentCount < requestCount){
+                struct ServerRequestHeader header = {sentCount++};
+                memcpy(message, &header, sizeof(header));
+                getMonotonicTime(&sentTimes[i]);
+                sendWithFileDescriptors(sockets[i], message, messageLength, nullFileDescriptors, SERVER_FILE_DESCRIPTOR_COUNT);
+            }
+        }
+    }
+    double seconds = getElapsedMicroseconds(&benchmarkStart) / 1000000.0;
+    char p50[32];
+    char p99[32];
+    char max[32];
+    formatMicroseconds(getLatencyPercentile(latencyStats, 50), p50);
+    formatMicroseconds(getLatencyPercentile(latencyStats, 99), p99);
+    formatMicroseconds(latencyStats->maxMicroseconds, max);
+    printf("%d requests (%d failed) over %d connections in %.3fs: %.0f requests/s, latency p50 %s p99 %s max %s\n", completedCount, failedCount, connectionCount, seconds, completedCount / seconds, p50, p99, max);
+    for(i = 0; i < connectionCount; ++i){
+        close(sockets[i]);
+    }
+    close(nullFileDescriptor);
+    free(latencyStats);
+    free(pollFileDescriptors);
+    free(sentTimes);
+    free(sockets);
+    return failedCount > 0;
 }
 
-//action that parent takes while child process is executing command
-//involves either waiting for child process to finish executing in the foreground, or 
-//adding background process to list of background processes if it is to execute in background
-//returns status code from child in foreground after finishes executing, or 0 if child is started in background
-//childProcessId is child process id from fork()
-int parentProcessExecuteCommand(pid_t childProcessId, struct BackgroundProcessList *backgroundProcessList, BOOL isBackgroundCommand){
-    //run command in foreground, so wait for it to finish
-    if(isBackgroundCommand == FALSE){ 
-        //create variable to store return value from child process
-        int status = 0;
-        //set global foregroundPid so interrupt (control-c) will end it
-        foregroundPid = childProcessId;
-        waitpid(childProcessId, &status, 0);
-        //clear foregroundPid, since the process has finished
-        //foregroundPid = -1;
-        //if there was an error calling waitpid
-        //return value will be -1, however this will also happen if foreground process is interrupted,
-        //so there is no need to check this, as we will just get false positives
+//joins arguments from index start onwards with spaces into commandLineBuffer
+void joinArguments(int argc, char const *argv[], int start, char commandLineBuffer[COMMAND_LINE_MAX_LENGTH]){
+    commandLineBuffer[0] = '\0';
+    int i;
+    for(i = start; i < argc; ++i){
+        if(strlen(commandLineBuffer) + strlen(argv[i]) + 2 > COMMAND_LINE_MAX_LENGTH){
+            break;
+        }
+        if(i > start){
+            strcat(commandLineBuffer, " ");
+        }
+        strcat(commandLineBuffer, argv[i]);
+    }
+}
 
+//prints how to start smallsh
+//returns exit status 1, since it is only printed for invalid options
+int printProgramUsage(){
+    printf("usage: smallsh [--fork-server] [--journal FILE [--resume]]\n");
+    printf("       smallsh --server SOCKET [--max-jobs N] [--max-client-jobs N]\n");
+    printf("       smallsh --connect SOCKET command\n");
+    printf("       smallsh --bench SOCKET [-n REQUESTS] [-c CONNECTIONS] command\n");
+    return 1;
+}
 
-        //check if process interrupted
-        //if so, status is meaningless, since signal number will be used in status
-        //have to print here, since we can't print in signal handler due to printf not being re-entrant
-        if(foregroundInterrupted == TRUE){
-            //0 is meaningless, since signal number will be used
-            printStatus(0);
+//runs server, client or benchmark mode given by command line options
+//returns exit status for the program
+int runSocketMode(int argc, char const *argv[]){
+    if(argc < 3){
+        return printProgramUsage();
+    }
+    const char *mode = argv[1];
+    const char *socketPath = argv[2];
+    //default to a few jobs per cpu, with no extra limit per client
+    int maxJobs = sysconf(_SC_NPROCESSORS_ONLN) * 4;
+    int maxClientJobs = -1;
+    int requestCount = 1000;
+    int connectionCount = 1;
+    int i = 3;
+    while(i + 1 < argc && argv[i][0] == '-'){
+        int value = atoi(argv[i + 1]);
+        if(value < 1){
+            return printProgramUsage();
         }
-        //examine status - 0 means success, other values mean there was an error or 
-        //process was interrupted
-        //so normalize it for return value
-        else if(status != 0){
-            status = 1;
+        if(strcmp(argv[i], "--max-jobs") == 0){
+            maxJobs = value;
         }
-        return status;
+        else if(strcmp(argv[i], "--max-client-jobs") == 0){
+            maxClientJobs = value;
+        }
+        else if(strcmp(argv[i], "-n") == 0){
+            requestCount = value;
+        }
+        else if(strcmp(argv[i], "-c") == 0){
+            connectionCount = value;
+        }
+        else{
+            return printProgramUsage();
+        }
+        i += 2;
     }
-    //command is background process
-    //so just add to background processes and return immediately
-    else{
-        //print pid of child process
-        //http://stackoverflow.com/questions/20533606/what-is-the-correct-printf-specifier-for-printing-pid-t
-        printf("background pid is %ld\n", (long) childProcessId);
-        addToBackgroundProcessList(childProcessId, backgroundProcessList);
-        return 0;
+    if(strcmp(mode, "--server") == 0){
+        if(i != argc){
+            return printProgramUsage();
+        }
+        return runServer(socketPath, maxJobs, maxClientJobs == -1 ? maxJobs : maxClientJobs);
     }
+    if(i == argc){
+        return printProgramUsage();
+    }
+    char commandLineBuffer[COMMAND_LINE_MAX_LENGTH];
+    joinArguments(argc, argv, i, commandLineBuffer);
+    if(strcmp(mode, "--connect") == 0){
+        return runClient(socketPath, commandLineBuffer);
+    }
+    if(strcmp(mode, "--bench") == 0){
+        return runServerBenchmark(socketPath, commandLineBuffer, requestCount, connectionCount);
+    }
+    return printProgramUsage();
 }
 
+/*************************************
+* Command list functions
+**************************************/
 
-////////////////////////////////////////
-// Main command execution function
-////////////////////////////////////////
+//how a command in a command list is joined to the one before it
+//';' or '&' (or being first) always runs it, '&&' only if the one before succeeded, and '||' only if it failed
+#define LIST_SEQUENCE 0
+#define LIST_AND 1
+#define LIST_OR 2
 
-//creates a separate process to execute command given in commandLineBuffer and then
-//executes the command
-//return 0 if process succeeded, or 1 if it doesn't
-//based on: https://support.sas.com/documentation/onlinedoc/sasc/doc/lr2/waitpid.htm
-int executeCommand(char commandLineBuffer[COMMAND_LINE_MAX_LENGTH], int bufferLength, struct BackgroundProcessList *backgroundProcessList){
-    //find out if command should be executed in background
-    BOOL isBackgroundCommand = shouldExecuteInBackground(commandLineBuffer, bufferLength);
-    //create new child process to execute command
-    pid_t processId = fork();
+//command in a command list
+struct ListCommand{
+    //start of the command in the list's buffer, without surrounding whitespace
+    char *commandLine;
+    //TRUE if command was followed by '&'
+    BOOL isBackgroundCommand;
+    //LIST_* for how it is joined to the command before it
+    int connector;
+};
 
-    //branch based on process id so parent and child do different things:
-    //child executes command and parent waits for it if it is in the foreground or
-    //adds to background processes if it is in the background
-    switch(processId){
-        //error with fork
-        case -1:
-            printf("Could not create new process to execute %s\n", commandLineBuffer);
-            return 1;
-            break;
-        //child process executing command
-        case 0:
-            childProcessExecuteCommand(commandLineBuffer, bufferLength, isBackgroundCommand);
-            //should not reach here, because childProcessExecuteCommand exits, but we need return
-            //statement so compiler doesn't complain
-            return 0;
-            break;
-        //parent process
-        //wait for child to finish executing (if done in foreground) and return result
-        //otherwise just add to background processes and return 0
-        default:
-            return parentProcessExecuteCommand(processId, backgroundProcessList, isBackgroundCommand);
-            break;
+//line of commands separated by ';', '&&', '||' or '&'
+//the line is split up once, before any of the commands are run
+struct CommandList{
+    char buffer[COMMAND_LINE_MAX_LENGTH];
+    struct ListCommand commands[MAX_ARGUMENT_COUNT];
+    int commandCount;
+};
+
+//splits commandLineBuffer into commandList
+//returns FALSE, after printing the problem, if an operator is missing a command
+BOOL parseCommandList(char commandLineBuffer[COMMAND_LINE_MAX_LENGTH], struct CommandList *commandList){
+    strcpy(commandList->buffer, commandLineBuffer);
+    commandList->commandCount = 0;
+    char *cursor = commandList->buffer;
+    char *commandStart = cursor;
+    int connector = LIST_SEQUENCE;
+    while(1){
+        //find next operator, or the end of the line
+        char operator[3] = "";
+        int nextConnector = LIST_SEQUENCE;
+        BOOL isBackgroundCommand = FALSE;
+        if((cursor[0] == '&' && cursor[1] == '&') || (cursor[0] == '|' && cursor[1] == '|')){
+            memcpy(operator, cursor, 2);
+            operator[2] = '\0';
+            nextConnector = cursor[0] == '&' ? LIST_AND : LIST_OR;
+        }
+        else if(cursor[0] == ';' || cursor[0] == '&'){
+            operator[0] = cursor[0];
+            isBackgroundCommand = cursor[0] == '&';
+        }
+        else if(cursor[0] != '\0'){
+            cursor++;
+            continue;
+        }
+        BOOL isEnd = cursor[0] == '\0';
+        //trim whitespace around command
+        *cursor = '\0';
+        while(isspace(*commandStart)){
+            commandStart++;
+        }
+        char *commandEnd = cursor;
+        while(commandEnd > commandStart && isspace(commandEnd[-1])){
+            *--commandEnd = '\0';
+        }
+        if(*commandStart != '\0' && commandList->commandCount == MAX_ARGUMENT_COUNT){
+            printf("syntax error: too many commands (at most %d on one line)\n", MAX_ARGUMENT_COUNT);
+            return FALSE;
+        }
+        if(*commandStart != '\0'){
+            struct ListCommand *command = &commandList->commands[commandList->commandCount++];
+            command->commandLine = commandStart;
+            command->isBackgroundCommand = isBackgroundCommand;
+            command->connector = connector;
+        }
+        //only a final ';' or '&' can be left without a command after it
+        else if(isEnd == FALSE || connector != LIST_SEQUENCE || commandList->commandCount == 0){
+            printf("syntax error: missing command %s '%s'\n", isEnd ? "after" : "before", isEnd ? (connector == LIST_AND ? "&&" : "||") : operator);
+            return FALSE;
+        }
+        if(isEnd == TRUE){
+            return TRUE;
+        }
+        connector = nextConnector;
+        cursor += strlen(operator);
+        commandStart = cursor;
     }
 }
 
-
-///////////////////////////////////////////////////////////
-// Background process commands
-///////////////////////////////////////////////////////////
-
-//returns true if process has either exited normally or topped by signal
-//false otherwise
-//status is the int passed in from waitpid
-//based on: https://linux.die.net/man/2/waitpid
-BOOL hasProcessStopped(pid_t childProcessId, pid_t waitpidResult, int status){
-    //wait pid result will be 0 if no status is available
-    if(waitpidResult == 0){
+//executes one command from a command list in commandLineBuffer, either a built in command or a program
+//returnStatusCode holds the status of the command before, and is set to the status of this one
+//returns FALSE if the command was 'exit', so the shell should exit
+BOOL executeListCommand(char commandLineBuffer[COMMAND_LINE_MAX_LENGTH], struct BackgroundProcessList *backgroundProcessList, int *returnStatusCode){
+    //cache string length here, since we will be using it multiple places
+    //to parse command
+    int bufferLength = strlen(commandLineBuffer);
+    //check for 'exit' command to exit
+    if(strcmp(commandLineBuffer, "exit") == 0){
         return FALSE;
     }
-    //if the process has exited, or stopped by signal, it has stopped
-    if(WIFEXITED(status) || WIFSIGNALED(status)){
-        return TRUE;
+    //check for 'status' command to print status
+    else if(strcmp(commandLineBuffer, "status") == 0){
+        *returnStatusCode = printStatus(*returnStatusCode);
+        //built in commands reset foreground pid
+        //so printStatus works correctly
+        foregroundPid = NULL_FOREGROUND_PID;
+        //also reset process interrupted, since built-in commands can't be interrupted
+        foregroundInterrupted = FALSE;
     }
-    //process must still be running
-    return FALSE;
+    else if(isCommandCD(commandLineBuffer, bufferLength) == 1){
+        *returnStatusCode = executeCD(commandLineBuffer, bufferLength);
+        //built in commands reset foreground pid
+        //so printStatus works correctly
+        foregroundPid = NULL_FOREGROUND_PID;
+        //also reset process interrupted, since built-in commands can't be interrupted
+        foregroundInterrupted = FALSE;
+    }
+    //check for 'stats' command to print command statistics
+    else if(isBuiltinCommand(commandLineBuffer, bufferLength, "stats")){
+        *returnStatusCode = executeStats(commandLineBuffer);
+        //built in commands reset foreground pid
+        //so printStatus works correctly
+        foregroundPid = NULL_FOREGROUND_PID;
+        //also reset process interrupted, since built-in commands can't be interrupted
+        foregroundInterrupted = FALSE;
+    }
+    //check for 'wait' command to wait for background processes
+    else if(isBuiltinCommand(commandLineBuffer, bufferLength, "wait")){
+        //built in commands reset foreground pid
+        //so printStatus works correctly
+        foregroundPid = NULL_FOREGROUND_PID;
+        //reset process interrupted, wait sets it if the process it waited for was terminated by a signal
+        foregroundInterrupted = FALSE;
+        *returnStatusCode = executeWait(commandLineBuffer, backgroundProcessList);
+    }
+    //check for 'joblog' command to capture and print output of background commands
+    else if(isBuiltinCommand(commandLineBuffer, bufferLength, "joblog")){
+        //built in commands reset foreground pid
+        //so printStatus works correctly
+        //reset before running it, since 'joblog --follow' waits for control-c, which shouldn't be sent to the last foreground command
+        foregroundPid = NULL_FOREGROUND_PID;
+        //also reset process interrupted, since built-in commands can't be interrupted
+        foregroundInterrupted = FALSE;
+        *returnStatusCode = executeJobLog(commandLineBuffer, backgroundProcessList);
+    }
+    //check for 'admit' command to change admission control for background commands
+    else if(isBuiltinCommand(commandLineBuffer, bufferLength, "admit")){
+        *returnStatusCode = executeAdmit(commandLineBuffer, backgroundProcessList);
+        //built in commands reset foreground pid
+        //so printStatus works correctly
+        foregroundPid = NULL_FOREGROUND_PID;
+        //also reset process interrupted, since built-in commands can't be interrupted
+        foregroundInterrupted = FALSE;
+    }
+    //check for 'taskrun' command to run tasks from a task file
+    else if(isBuiltinCommand(commandLineBuffer, bufferLength, "taskrun")){
+        //built in commands reset foreground pid
+        //so printStatus works correctly
+        //reset before running it, since taskrun waits for control-c, which shouldn't be sent to the last foreground command
+        foregroundPid = NULL_FOREGROUND_PID;
+        //also reset process interrupted, since taskrun reports interrupted tasks itself
+        foregroundInterrupted = FALSE;
+        *returnStatusCode = executeTaskrun(commandLineBuffer, backgroundProcessList);
+    }
+    //check for 'cat' and 'cp' commands, which are run in the shell when possible
+    else if(isFileCommandLine(commandLineBuffer, bufferLength)){
+        //built in commands reset foreground pid
+        //so printStatus works correctly
+        //reset before copying, since control-c while copying shouldn't be sent to the last foreground command
+        foregroundPid = NULL_FOREGROUND_PID;
+        //also reset process interrupted, since control-c just stops copying
+        foregroundInterrupted = FALSE;
+        *returnStatusCode = executeFileCommand(commandLineBuffer, bufferLength, backgroundProcessList);
+    }
+    //check for 'timeout' command to run command with a deadline
+    else if(isBuiltinCommand(commandLineBuffer, bufferLength, "timeout")){
+        //reset foreground interrupted, since the command may be interrupted or time out
+        foregroundInterrupted = FALSE;
+        *returnStatusCode = executeTimeout(commandLineBuffer, bufferLength, backgroundProcessList);
+    }
+    else{
+        //reset foreground interrupted, since nothing has happed yet, so can't be interrupted
+        foregroundInterrupted = FALSE;
+        //if we're here, we are executing user command
+        *returnStatusCode = executeCommand(commandLineBuffer, bufferLength, backgroundProcessList, NULL);
+    }
+    return TRUE;
 }
 
-//prints out status of completed background processes
-//and removes completed background processes from the list
-void printBackgroundProcessStatus(struct BackgroundProcessList *backgroundProcessList){
-    struct BackgroundProcessNode *node = backgroundProcessList->head;
-    //initialize variable for status information in waitpid
-    int status = 0;
-    //iterate through all background processes, stopping them and freeing memory from the list
-    while(node != NULL){
-        //check process to see if still running
-        pid_t waitpidResult = waitpid(node->processId, &status, WNOHANG);
-        //don't do anything if process is still running
-        if(!hasProcessStopped(node->processId, waitpidResult, status)){
-            //process still running, continue with next node
-            node = node->next;
+//runs the commands in commandList in order
+//commands after '&&' are skipped if the command before failed, and commands after '||' if it succeeded,
+//where failing means 'status' would report a non-zero exit value or a signal
+//control-c stops the rest of the list too
+//returns FALSE if one of the commands was 'exit', so the shell should exit
+BOOL executeCommandList(struct CommandList *commandList, struct BackgroundProcessList *backgroundProcessList, int *returnStatusCode){
+    int i;
+    for(i = 0; i < commandList->commandCount; ++i){
+        struct ListCommand *command = &commandList->commands[i];
+        BOOL isSuccess = *returnStatusCode == 0 && foregroundInterrupted == FALSE;
+        if(i > 0 && ((command->connector == LIST_AND && isSuccess == FALSE) || (command->connector == LIST_OR && isSuccess == TRUE))){
             continue;
         }
-        //print out exit status of completed process in format
-        //background pid 4923 is done: exit value 0
-        //or
-        //background pid 4941 is done: terminated by signal 15
-        //based on: https://linux.die.net/man/3/waitpid
-        //check for exiting normally
-        if(WIFEXITED(status)){
-            printf("background pid %ld is done: exit value %d\n", (long) node->processId, WEXITSTATUS(status));
+        //running a command changes its command line, and '$$' can make it longer, so give each one its own copy
+        char commandLineBuffer[COMMAND_LINE_MAX_LENGTH];
+        strcpy(commandLineBuffer, command->commandLine);
+        //a command followed by '&' always has room for it, since it was in the line
+        if(command->isBackgroundCommand == TRUE){
+            strcat(commandLineBuffer, "&");
         }
-        //otherwise killed by signal
-        else{
-            printf("background pid %ld is done: terminated by signal %d\n", (long) node->processId, WTERMSIG(status));
+        if(executeListCommand(commandLineBuffer, backgroundProcessList, returnStatusCode) == FALSE){
+            return FALSE;
+        }
+        if(foregroundInterrupted == TRUE && foregroundInterruptSignal == SIGINT){
+            break;
         }
+    }
+    return TRUE;
+}
 
 
-        //remove completed process from the list
-        //duplicate node, so we can store pointer to next node
-        //before deleting current node
-        struct BackgroundProcessNode *garbage = node;
-        node = node->next;
-        //free memory for current node
-        removeFromBackgroundProcessList(garbage, backgroundProcessList);
+/*************************************
+* Journaled run functions
+**************************************/
+
+//returns TRUE if commandLine is a built in command that changes how later commands run:
+//'cd', 'timeout --background DURATION', 'admit' with settings, and 'joblog on' or 'joblog off'
+BOOL isStateCommand(char *commandLine){
+    char *cursor = commandLine;
+    char name[COMMAND_LINE_MAX_LENGTH];
+    char argument[COMMAND_LINE_MAX_LENGTH];
+    if(readNextWord(&cursor, name) == FALSE){
+        return FALSE;
+    }
+    BOOL hasArgument = readNextWord(&cursor, argument);
+    if(strcmp(name, "cd") == 0){
+        return TRUE;
+    }
+    if(strcmp(name, "timeout") == 0){
+        return hasArgument == TRUE && strcmp(argument, "--background") == 0 && readNextWord(&cursor, argument) == TRUE;
+    }
+    if(strcmp(name, "admit") == 0){
+        return hasArgument;
+    }
+    if(strcmp(name, "joblog") == 0){
+        return hasArgument == TRUE && (strcmp(argument, "on") == 0 || strcmp(argument, "off") == 0);
     }
+    return FALSE;
 }
 
-
-//kill all background processes
-//and free memory from background process list
-//called before program exits
-void cleanUpBackgroundProcesses(struct BackgroundProcessList *backgroundProcessList){
-    struct BackgroundProcessNode *node = backgroundProcessList->head;
-    //initialize variable for status information in waitpid
-    int status = 0;
-    //iterate through all background processes, stopping them and freeing memory from the list
-    while(node != NULL){
-        //check process to see if still running
-        pid_t waitpidResult = waitpid(node->processId, &status, WNOHANG);
-        //kill background process if still running
-        //based on: http://stackoverflow.com/questions/6501522/how-to-kill-a-child-process-by-the-parent-process
-        if(!hasProcessStopped(node->processId, waitpidResult, status)){
-            //send kill signal
-            kill(node->processId, SIGKILL);
+//runs the commands in commandList, from line lineNumber of the input with hash lineHash,
+//recording in the journal when the line starts and when it completes
+//a line that completed in the journal being resumed is skipped, except for commands that change how later commands run,
+//which are run again so the lines after it run the same way as before
+//only ones that always run are run again - whether a command after '&&' or '||' ran depended on a status that is no longer known
+//returns FALSE if one of the commands was 'exit' - the line is left incomplete, so resuming exits at the same place
+BOOL executeJournaledCommandList(struct CommandList *commandList, uint32_t lineNumber, uint64_t lineHash, struct BackgroundProcessList *backgroundProcessList, int *returnStatusCode){
+    if(isJournalLineCompleted(lineNumber, lineHash) == TRUE){
+        journal.skippedLineCount++;
+        int i;
+        for(i = 0; i < commandList->commandCount; ++i){
+            char commandLineBuffer[COMMAND_LINE_MAX_LENGTH];
+            strcpy(commandLineBuffer, commandList->commands[i].commandLine);
+            if(commandList->commands[i].connector == LIST_SEQUENCE && isStateCommand(commandLineBuffer) == TRUE){
+                int statusCode;
+                executeListCommand(commandLineBuffer, backgroundProcessList, &statusCode);
+            }
         }
-
-        //duplicate node, so we can store pointer to next node
-        //before deleting current node
-        struct BackgroundProcessNode *garbage = node;
-        node = node->next;
-        //free memory for current node
-        removeFromBackgroundProcessList(garbage, backgroundProcessList);
+        return TRUE;
     }
+    struct JournalLine *line = startJournalLine(lineNumber, lineHash);
+    if(executeCommandList(commandList, backgroundProcessList, returnStatusCode) == FALSE){
+        journal.currentLine = NULL;
+        return FALSE;
+    }
+    finishJournalLine(line);
+    return TRUE;
 }
 
+
 /**
 * Main function
 */
 int main(int argc, char const *argv[]){
+    shellProcessId = getpid();
+    //options for the interactive shell come first
+    int argumentIndex = 1;
+    BOOL useForkServer = FALSE;
+    const char *journalPath = NULL;
+    BOOL isResuming = FALSE;
+    while(argumentIndex < argc){
+        if(strcmp(argv[argumentIndex], "--fork-server") == 0){
+            useForkServer = TRUE;
+        }
+        else if(strcmp(argv[argumentIndex], "--resume") == 0){
+            isResuming = TRUE;
+        }
+        else if(strcmp(argv[argumentIndex], "--journal") == 0 && argumentIndex + 1 < argc){
+            journalPath = argv[++argumentIndex];
+        }
+        else{
+            break;
+        }
+        argumentIndex++;
+    }
+    //server, client and benchmark modes don't read commands from standard input
+    if(argumentIndex > 1 && (argumentIndex < argc || (isResuming == TRUE && journalPath == NULL))){
+        return printProgramUsage();
+    }
+    //fork server is started before anything else, while the shell is still small
+    if(useForkServer == TRUE){
+        startForkServer();
+    }
+    //initialize handler to wake the shell when child processes finish
+    initializeChildSignalHandler();
+    initializeBackgroundDeadlineTimer();
+    initializeAdmissionController();
+    if(argumentIndex < argc){
+        return runSocketMode(argc, argv);
+    }
+    if(journalPath != NULL && openJournal(journalPath, isResuming) == FALSE){
+        return 1;
+    }
     //initialize interrupt (control-c) handler
     initializeInterruptHandler();
 
@@ -870,6 +6574,10 @@ int main(int argc, char const *argv[]){
     //initialize list to hold background process information
     struct BackgroundProcessList backgroundProcessList;
     initializeBackgroundProcessList(&backgroundProcessList);
+    //commands from the current line
+    struct CommandList commandList;
+    //number of the current line of input, used to identify it in the journal
+    uint32_t lineNumber = 0;
 	//main loop to get user input and execute commands
     //loops until user types 'exit' to exit shell
     while(1){
@@ -881,10 +6589,12 @@ int main(int argc, char const *argv[]){
     	//write user prompt
     	writePrompt();
         //get user input for command
-        getUserInput(commandLineBuffer);
+        //end of input (control-d, or end of a script) exits like 'exit'
+        if(getUserInput(commandLineBuffer, &backgroundProcessList) == FALSE){
+            break;
+        }
+        lineNumber++;
         
-        //cache string length here, since we will be using it multiple places
-        //to parse command
         int bufferLength = strlen(commandLineBuffer);
 
         //check if line is empty or a comment
@@ -893,32 +6603,19 @@ int main(int argc, char const *argv[]){
         	//line is a comment or empty, so don't do anything
         	continue;
         }
-        //check for 'exit' command to exit
-        else if(strcmp(commandLineBuffer, "exit") == 0){
-            break;
-        }
-        //check for 'status' command to print status
-        else if(strcmp(commandLineBuffer, "status") == 0){
-            returnStatusCode = printStatus(returnStatusCode);
-            //built in commands reset foreground pid
-            //so printStatus works correctly
-            foregroundPid = NULL_FOREGROUND_PID;
-            //also reset process interrupted, since built-in commands can't be interrupted
+        //split line into its commands and run them
+        //(a line with no operators is a list of one command)
+        if(parseCommandList(commandLineBuffer, &commandList) == FALSE){
+            returnStatusCode = 1;
             foregroundInterrupted = FALSE;
         }
-        else if(isCommandCD(commandLineBuffer, bufferLength) == 1){
-            returnStatusCode = executeCD(commandLineBuffer, bufferLength);
-            //built in commands reset foreground pid
-            //so printStatus works correctly
-            foregroundPid = NULL_FOREGROUND_PID;
-            //also reset process interrupted, since built-in commands can't be interrupted
-            foregroundInterrupted = FALSE;
+        else if(journal.fileDescriptor != -1){
+            if(executeJournaledCommandList(&commandList, lineNumber, hashString(commandLineBuffer, bufferLength), &backgroundProcessList, &returnStatusCode) == FALSE){
+                break;
+            }
         }
-        else{
-            //reset foreground interrupted, since nothing has happed yet, so can't be interrupted
-            foregroundInterrupted = FALSE;
-            //if we're here, we are executing user command
-            returnStatusCode = executeCommand(commandLineBuffer, bufferLength, &backgroundProcessList);
+        else if(executeCommandList(&commandList, &backgroundProcessList, &returnStatusCode) == FALSE){
+            break;
         }
     }
 
@@ -926,7 +6623,12 @@ int main(int argc, char const *argv[]){
     //kill all background child processes
     //and free memory from list
     //don't need to worry about foreground process, since if we are here, there isn't one currently running
+    discardQueuedCommands();
     cleanUpBackgroundProcesses(&backgroundProcessList);
+    //remove captured output, which is only kept while the shell is running
+    destroyJobLogs();
+    //background commands killed above never completed, so their lines are recorded as killed, and run again once when resuming
+    closeJournal();
 
 
 	return 0;